@@ -0,0 +1,568 @@
+
+/*
+ * Throughput benchmark of XMLWrapper, it runs offline on a synthetic feed (or on a local file):
+ *
+ *	XMLWrapperBenchmark [--records <n>] [--depth <n>] [--namespaces] [--iterations <n>]
+ *		[--file <pathName> --record-path <path> --field <relative expression>] [--parser-options default|fastReadOnly] [--arena]
+ *		[--metrics]
+ *
+ * i.e.
+ *	XMLWrapperBenchmark --records 200000 --depth 4 --namespaces
+ *	XMLWrapperBenchmark --file /var/tmp/catalogue.xml --record-path /feed/entry --field title/text()
+ *
+ * --parser-options selects how the document used by the query benchmarks is loaded,
+ * --arena loads the documents in arena mode (the document memory cannot be counted in that case),
+ * --metrics enables the XMLWrapper metrics (to measure their overhead) and prints them at the end
+ */
+
+#include "XMLWrapper.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sys/resource.h>
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+struct Options
+{
+	size_t records = 50000;
+	size_t depth = 3;
+	bool namespaces = false;
+	size_t iterations = 3;
+	string pathName;
+	string recordPath = "/feed/entry";
+	string field = "title/text()";
+	bool fastReadOnly = false;
+	bool arena = false;
+	bool metrics = false;
+};
+
+const vector<pair<string, string>> nameServices = {{"media", "http://search.yahoo.com/mrss/"}};
+
+// fields of the synthetic entry bound by bindMemory
+struct BoundEntry
+{
+	string id;
+	int64_t type = 0;
+	string title;
+	double price = 0;
+};
+
+// every entry has some attributes, few text fields and a chain of depth nested elements
+string generateFeed(const Options &options)
+{
+	string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+	xml += options.namespaces ? std::format("<feed xmlns:media=\"{}\">\n", nameServices[0].second) : "<feed>\n";
+	for (size_t recordIndex = 0; recordIndex < options.records; recordIndex++)
+	{
+		xml += std::format(
+			"<entry id=\"{}\" type=\"{}\"><title>Title of the entry number {}</title><price>{}.99</price>"
+			"<description>Long description of the entry, long enough to look like a real one</description>",
+			recordIndex, recordIndex % 3, recordIndex, recordIndex % 1000
+		);
+		for (size_t depthIndex = 0; depthIndex < options.depth; depthIndex++)
+			xml += std::format("<level{}>", depthIndex);
+		xml += "<value>nested</value>";
+		for (size_t depthIndex = options.depth; depthIndex > 0; depthIndex--)
+			xml += std::format("</level{}>", depthIndex - 1);
+		if (options.namespaces)
+			xml += std::format("<media:content url=\"http://cdn.example.com/{}.jpg\" medium=\"image\"/>", recordIndex);
+		else
+			xml += std::format("<content url=\"http://cdn.example.com/{}.jpg\" medium=\"image\"/>", recordIndex);
+		xml += "</entry>\n";
+	}
+	xml += "</feed>\n";
+
+	return xml;
+}
+
+// bytes currently allocated by libxml2, counted through xmlMemSetup to compare the size of the DOMs
+atomic<int64_t> libxml2Bytes = 0;
+
+size_t usableSize(void *pointer)
+{
+#ifdef __APPLE__
+	return malloc_size(pointer);
+#else
+	return malloc_usable_size(pointer);
+#endif
+}
+
+void *countingMalloc(const size_t size)
+{
+	void *pointer = malloc(size);
+	if (pointer != nullptr)
+		libxml2Bytes += static_cast<int64_t>(usableSize(pointer));
+	return pointer;
+}
+
+void countingFree(void *pointer)
+{
+	if (pointer != nullptr)
+		libxml2Bytes -= static_cast<int64_t>(usableSize(pointer));
+	free(pointer);
+}
+
+void *countingRealloc(void *pointer, const size_t size)
+{
+	const size_t previousSize = pointer != nullptr ? usableSize(pointer) : 0;
+	void *newPointer = realloc(pointer, size);
+	if (newPointer != nullptr)
+		libxml2Bytes += static_cast<int64_t>(usableSize(newPointer)) - static_cast<int64_t>(previousSize);
+	return newPointer;
+}
+
+char *countingStrdup(const char *source)
+{
+	char *pointer = strdup(source);
+	if (pointer != nullptr)
+		libxml2Bytes += static_cast<int64_t>(usableSize(pointer));
+	return pointer;
+}
+
+size_t peakRSSInKB()
+{
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+// best time of the iterations, in seconds
+template <typename Function> double measure(const size_t iterations, Function &&function)
+{
+	double best = 0;
+	for (size_t iteration = 0; iteration < iterations; iteration++)
+	{
+		const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		function();
+		const double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		if (iteration == 0 || elapsed < best)
+			best = elapsed;
+	}
+
+	return best;
+}
+
+void report(const string &name, const double seconds, const double units, const string &unitName)
+{
+	cout << std::format("{:<32} {:>10.3f} ms {:>14.1f} {}/s", name, seconds * 1000, seconds > 0 ? units / seconds : 0, unitName) << endl;
+}
+
+Options parseArguments(const int argc, char **argv)
+{
+	Options options;
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		const string arg = argv[argIndex];
+		auto nextArg = [&]() -> string
+		{
+			if (argIndex + 1 >= argc)
+				throw runtime_error(std::format("missing value of {}", arg));
+			return argv[++argIndex];
+		};
+		if (arg == "--records")
+			options.records = stoul(nextArg());
+		else if (arg == "--depth")
+			options.depth = stoul(nextArg());
+		else if (arg == "--namespaces")
+			options.namespaces = true;
+		else if (arg == "--iterations")
+			options.iterations = max<size_t>(stoul(nextArg()), 1);
+		else if (arg == "--file")
+			options.pathName = nextArg();
+		else if (arg == "--record-path")
+			options.recordPath = nextArg();
+		else if (arg == "--field")
+			options.field = nextArg();
+		else if (arg == "--parser-options")
+		{
+			const string parserOptions = nextArg();
+			if (parserOptions != "default" && parserOptions != "fastReadOnly")
+				throw runtime_error(std::format("unknown parser options: {}", parserOptions));
+			options.fastReadOnly = parserOptions == "fastReadOnly";
+		}
+		else if (arg == "--arena")
+			options.arena = true;
+		else if (arg == "--metrics")
+			options.metrics = true;
+		else
+			throw runtime_error(std::format("unknown argument: {}", arg));
+	}
+
+	return options;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	try
+	{
+		const Options options = parseArguments(argc, argv);
+
+		// before any libxml2 allocation
+		if (options.arena)
+			XMLWrapper::enableArenaAllocation();
+		else
+			xmlMemSetup(countingFree, countingMalloc, countingRealloc, countingStrdup);
+		XMLWrapper::enableMetrics(options.metrics);
+
+		string pathName = options.pathName;
+		if (pathName.empty())
+		{
+			pathName = (filesystem::temp_directory_path() / "XMLWrapperBenchmark.xml").string();
+			ofstream(pathName, ios::binary) << generateFeed(options);
+		}
+		const double megaBytes = static_cast<double>(filesystem::file_size(pathName)) / (1024 * 1024);
+		string xml;
+		{
+			ifstream in(pathName, ios::binary);
+			xml.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+		}
+		cout << std::format("file: {}, size: {:.1f} MB", pathName, megaBytes) << endl;
+		const size_t initialRSS = peakRSSInKB();
+
+		const XMLParserOptions fastReadOnly = XMLParserOptions::fastReadOnly();
+		XMLWrapper xmlWrapper;
+		xmlWrapper.setArenaAllocation(options.arena);
+
+		report("loadFromMemory", measure(options.iterations, [&]() { xmlWrapper.loadFromMemory(xml, nameServices); }), megaBytes, "MB");
+		report(
+			"loadFromMemory (fastReadOnly)", measure(options.iterations, [&]() { xmlWrapper.loadFromMemory(xml, nameServices, fastReadOnly); }),
+			megaBytes, "MB"
+		);
+		{
+			// a new XMLWrapper for every load, as an importer does for every feed
+			auto parserPool = make_shared<XMLParserPool>();
+			report(
+				"loadFromMemory (parser pool)",
+				measure(
+					options.iterations,
+					[&]()
+					{
+						XMLWrapper document(parserPool);
+						document.loadFromMemory(xml, nameServices);
+					}
+				),
+				megaBytes, "MB"
+			);
+		}
+		report("loadFromFile", measure(options.iterations, [&]() { xmlWrapper.loadFromFile(pathName, nameServices); }), megaBytes, "MB");
+		report(
+			"loadFromFile (fastReadOnly)", measure(options.iterations, [&]() { xmlWrapper.loadFromFile(pathName, nameServices, fastReadOnly); }),
+			megaBytes, "MB"
+		);
+
+		// memory allocated by libxml2 for the document (and its XPath context)
+		auto documentMegaBytes = [&](const XMLParserOptions &parserOptions) -> double
+		{
+			XMLWrapper document;
+			const int64_t before = libxml2Bytes;
+			document.loadFromMemory(xml, nameServices, parserOptions);
+
+			return static_cast<double>(libxml2Bytes - before) / (1024 * 1024);
+		};
+		if (!options.arena)
+			cout << std::format(
+						"document memory: {:.1f} MB (default), {:.1f} MB (noDict), {:.1f} MB (fastReadOnly)", documentMegaBytes({}),
+						documentMegaBytes({.noDict = true}), documentMegaBytes(fastReadOnly)
+					)
+				 << endl;
+
+		// only the time needed to free the document
+		double freeSeconds = 0;
+		for (size_t iteration = 0; iteration < options.iterations; iteration++)
+		{
+			auto document = make_unique<XMLWrapper>();
+			document->setArenaAllocation(options.arena);
+			document->loadFromMemory(xml, nameServices);
+			const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			document.reset();
+			const double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			if (iteration == 0 || elapsed < freeSeconds)
+				freeSeconds = elapsed;
+		}
+		report("free document", freeSeconds, megaBytes, "MB");
+
+		{
+			// the document rehydrated from the XMLDocumentCache, as at the restart of an importer
+			const string cacheDirectory = (filesystem::temp_directory_path() / "XMLWrapperBenchmark.cache").string();
+			auto documentCache = make_shared<XMLDocumentCache>(cacheDirectory);
+			XMLWrapper document;
+			document.setArenaAllocation(options.arena);
+			document.loadFromMemory(xml, nameServices);
+			report("XMLDocumentCache::store", measure(options.iterations, [&]() { documentCache->store(pathName, document); }), megaBytes, "MB");
+			document.setDocumentCache(documentCache);
+			report("loadFromCache", measure(options.iterations, [&]() { document.loadFromCache(pathName, nameServices); }), megaBytes, "MB");
+			cout << std::format("cached document: {:.1f} MB", static_cast<double>(filesystem::file_size(filesystem::directory_iterator(cacheDirectory)->path())) / (1024 * 1024)) << endl;
+			filesystem::remove_all(cacheDirectory);
+		}
+
+		xmlWrapper.loadFromFile(pathName, nameServices, options.fastReadOnly ? fastReadOnly : XMLParserOptions());
+		const size_t domRSS = peakRSSInKB();
+
+		size_t streamedRecords = 0;
+		double streamSeconds = measure(
+			options.iterations, [&]() { streamedRecords = XMLWrapper::streamMemory(xml, options.recordPath, nameServices, [](XMLWrapper &) {}); }
+		);
+		report("streamMemory", streamSeconds, static_cast<double>(streamedRecords), "records");
+		streamSeconds = measure(
+			options.iterations,
+			[&]() { streamedRecords = XMLWrapper::streamMemory(xml, options.recordPath, nameServices, [](XMLWrapper &) {}, fastReadOnly); }
+		);
+		report("streamMemory (fastReadOnly)", streamSeconds, static_cast<double>(streamedRecords), "records");
+
+		const XMLWrapper::XPathResult recordsResult = xmlWrapper.select(options.recordPath);
+		const vector<xmlNodePtr> recordNodes(recordsResult.begin(), recordsResult.end());
+		const auto records = static_cast<double>(recordNodes.size());
+		cout << std::format(
+					"records: {}, record path: {}, field: {}, parser options: {}", recordNodes.size(), options.recordPath, options.field,
+					options.fastReadOnly ? "fastReadOnly" : "default"
+				)
+			 << endl;
+
+		size_t found = 0;
+		report(
+			"xPath hit (asText)",
+			measure(
+				options.iterations,
+				[&]()
+				{
+					for (xmlNodePtr recordNode : recordNodes)
+						found += xmlWrapper.asText(options.field, recordNode, true).size();
+				}
+			),
+			records, "queries"
+		);
+		report(
+			"xPath hit (tryTextView)",
+			measure(
+				options.iterations,
+				[&]()
+				{
+					for (xmlNodePtr recordNode : recordNodes)
+						found += xmlWrapper.tryTextView(options.field, recordNode).value_or("").size();
+				}
+			),
+			records, "queries"
+		);
+		{
+			// the same relative path prefixed by self::node()/ is not a simple path and goes through the XPath engine
+			const string engineField = "self::node()/" + options.field;
+			report(
+				"simple path (tree walk)",
+				measure(
+					options.iterations,
+					[&]()
+					{
+						for (xmlNodePtr recordNode : recordNodes)
+							found += xmlWrapper.tryTextView(options.field, recordNode).value_or("").size();
+					}
+				),
+				records, "queries"
+			);
+			report(
+				"simple path (XPath engine)",
+				measure(
+					options.iterations,
+					[&]()
+					{
+						for (xmlNodePtr recordNode : recordNodes)
+							found += xmlWrapper.tryTextView(engineField, recordNode).value_or("").size();
+					}
+				),
+				records, "queries"
+			);
+			report(
+				"simple path select (tree walk)",
+				measure(
+					options.iterations,
+					[&]()
+					{
+						for (xmlNodePtr recordNode : recordNodes)
+							found += xmlWrapper.select(options.field, recordNode).size();
+					}
+				),
+				records, "queries"
+			);
+			report(
+				"simple path select (XPath engine)",
+				measure(
+					options.iterations,
+					[&]()
+					{
+						for (xmlNodePtr recordNode : recordNodes)
+							found += xmlWrapper.select(engineField, recordNode).size();
+					}
+				),
+				records, "queries"
+			);
+		}
+		report(
+			"xPath miss (asText emptyOnError)",
+			measure(
+				options.iterations,
+				[&]()
+				{
+					for (xmlNodePtr recordNode : recordNodes)
+						found += xmlWrapper.asText("missing/text()", recordNode, true).size();
+				}
+			),
+			records, "queries"
+		);
+		report(
+			"xPath miss (exists)",
+			measure(
+				options.iterations,
+				[&]()
+				{
+					for (xmlNodePtr recordNode : recordNodes)
+						found += xmlWrapper.exists("missing", recordNode);
+				}
+			),
+			records, "queries"
+		);
+		report(
+			"asAttribute(node)",
+			measure(
+				options.iterations,
+				[&]()
+				{
+					for (xmlNodePtr recordNode : recordNodes)
+						found += XMLWrapper::asAttribute(recordNode, "id", true).size();
+				}
+			),
+			records, "attributes"
+		);
+		report(
+			"tryAttributeView(node)",
+			measure(
+				options.iterations,
+				[&]()
+				{
+					for (xmlNodePtr recordNode : recordNodes)
+						found += XMLWrapper::tryAttributeView(recordNode, "id").value_or("").size();
+				}
+			),
+			records, "attributes"
+		);
+		{
+			// keyed lookups, i.e. //item[@id='...'] in a loop over ids: a sample of the keys since the XPath predicate scans the document
+			vector<string> keys;
+			for (size_t recordIndex = 0; recordIndex < recordNodes.size(); recordIndex += max<size_t>(recordNodes.size() / 20, 1))
+				keys.push_back(XMLWrapper::asAttribute(recordNodes[recordIndex], "id", true));
+			const auto lookups = static_cast<double>(keys.size());
+			report(
+				"keyed lookup (xPath predicate)",
+				measure(
+					options.iterations,
+					[&]()
+					{
+						for (const string &key : keys)
+							found += xmlWrapper.exists(std::format("{}[@id='{}']", options.recordPath, key));
+					}
+				),
+				lookups, "queries"
+			);
+			// built only by the first call
+			report("attribute index build", measure(1, [&]() { found += xmlWrapper.buildAttributeIndex(options.recordPath, "id"); }), records, "records");
+			report(
+				"keyed lookup (attribute index)",
+				measure(
+					options.iterations,
+					[&]()
+					{
+						for (const string &key : keys)
+							found += xmlWrapper.findByAttribute(options.recordPath, "id", key) != nullptr;
+					}
+				),
+				lookups, "queries"
+			);
+		}
+		report(
+			"extract (1 field)",
+			measure(options.iterations, [&]() { found += xmlWrapper.extract(options.recordPath, {{"field", options.field}}).records; }), records,
+			"records"
+		);
+
+		report(
+			"setAttribute (per record)",
+			measure(
+				options.iterations,
+				[&]()
+				{
+					for (xmlNodePtr recordNode : recordNodes)
+						xmlWrapper.setAttribute(".", 0, "enriched", "1", recordNode);
+				}
+			),
+			records, "records"
+		);
+		report(
+			"setAttributeAll", measure(options.iterations, [&]() { found += xmlWrapper.setAttributeAll(options.recordPath, "enriched", "2"); }), records,
+			"records"
+		);
+
+		{
+			// the same 4 fields through the DOM (load + extract) and through the SAX2 binding
+			const XMLBinding binding{
+				options.recordPath, XMLField{"@id", &BoundEntry::id}, XMLField{"@type", &BoundEntry::type}, XMLField{"title", &BoundEntry::title},
+				XMLField{"price", &BoundEntry::price}
+			};
+			const vector<pair<string, string>> fields = {{"id", "@id"}, {"type", "@type"}, {"title", "title/text()"}, {"price", "price/text()"}};
+			report(
+				"load + extract (4 fields)",
+				measure(
+					options.iterations,
+					[&]()
+					{
+						XMLWrapper document;
+						document.loadFromMemory(xml, nameServices);
+						found += document.extract(options.recordPath, fields, nullptr, 1).records;
+					}
+				),
+				records, "records"
+			);
+			report(
+				"bindMemory (4 fields)", measure(options.iterations, [&]() { found += XMLWrapper::bindMemory(xml, binding).size(); }), records, "records"
+			);
+		}
+
+		report("asString", measure(options.iterations, [&]() { found += xmlWrapper.asString().size(); }), megaBytes, "MB");
+		const string savedPathName = pathName + ".saved";
+		report("saveXMLFile", measure(options.iterations, [&]() { xmlWrapper.saveXMLFile(savedPathName, false); }), megaBytes, "MB");
+		filesystem::remove(savedPathName);
+
+		cout << std::format(
+					"peak RSS: {} KB (before loading: {} KB, after loading: {} KB), checksum: {}", peakRSSInKB(), initialRSS, domRSS, found
+				)
+			 << endl;
+		if (options.metrics)
+			cout << XMLWrapper::metricsText();
+
+		if (options.pathName.empty())
+			filesystem::remove(pathName);
+	}
+	catch (const exception &e)
+	{
+		cerr << "XMLWrapperBenchmark failed: " << e.what() << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
@@ -3,418 +3,5502 @@
 #include "../../StringUtils/src/StringUtils.h"
 #include "CurlWrapper.h"
 
+#include <atomic>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <chrono>
+#include <condition_variable>
+#include <curl/curl.h>
+#include <deque>
 #include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <libxml/parser.h>
+#include <libxml/parserInternals.h>
+#include <libxml/xmlerror.h>
+#include <libxml/xmlmemory.h>
 #include <libxml/xpathInternals.h>
+#include <limits>
+#include <list>
+#include <lzma.h>
+#include <mutex>
 #include <regex>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <zlib.h>
+#include <zstd.h>
 
 using namespace std;
 
-XMLWrapper::XMLWrapper()
+// every block, also the ones the hooks allocate on the heap, is preceded by a BlockHeader: the hooks know from it
+// if a block has to be freed or if it belongs to an arena, where nothing is freed until the whole arena is released
+class XMLDocumentArena
 {
-	_doc = nullptr;
-	_xpathCtx = nullptr;
+  public:
+	struct alignas(16) BlockHeader
+	{
+		size_t size;
+		XMLDocumentArena *arena; // nullptr if the block is on the heap
+	};
+
+	XMLDocumentArena() = default;
+
+	~XMLDocumentArena()
+	{
+		for (const Chunk &chunk : _chunks)
+			free(chunk.data);
+	}
+
+	XMLDocumentArena(const XMLDocumentArena &) = delete;
+	XMLDocumentArena &operator=(const XMLDocumentArena &) = delete;
+
+	void *allocate(const size_t size)
+	{
+		const size_t blockSize = sizeof(BlockHeader) + ((size + 15) & ~static_cast<size_t>(15));
+		if ((_chunks.empty() || _chunks.back().size - _used < blockSize) && !newChunk(blockSize))
+			return nullptr;
+
+		auto *header = reinterpret_cast<BlockHeader *>(_chunks.back().data + _used);
+		_used += blockSize;
+		header->size = size;
+		header->arena = this;
+
+		return header + 1;
+	}
+
+	// the first chunk is kept for the next document
+	void release()
+	{
+		for (size_t chunkIndex = 1; chunkIndex < _chunks.size(); chunkIndex++)
+			free(_chunks[chunkIndex].data);
+		if (_chunks.size() > 1)
+			_chunks.resize(1);
+		_used = 0;
+	}
+
+  private:
+	static constexpr size_t chunkSize = 1024 * 1024;
+
+	struct Chunk
+	{
+		char *data;
+		size_t size;
+	};
+	vector<Chunk> _chunks;
+	size_t _used = 0;
+
+	bool newChunk(const size_t blockSize)
+	{
+		// a block bigger than a chunk gets a chunk of its own
+		const size_t size = max(chunkSize, blockSize);
+		auto *data = static_cast<char *>(malloc(size));
+		if (data == nullptr)
+			return false;
+		try
+		{
+			_chunks.push_back({data, size});
+		}
+		catch (...)
+		{
+			free(data);
+
+			return false;
+		}
+		_used = 0;
+
+		return true;
+	}
+};
+
+struct XMLWrapper::CompiledXPath::SimplePath
+{
+	enum class StepType
+	{
+		Element,
+		Attribute,
+		Text
+	};
+
+	struct Step
+	{
+		StepType type = StepType::Element;
+		string prefix;
+		string name;		 // empty for *
+		size_t position = 0; // [n], 0 if every matching node is selected
+	};
+
+	bool absolute = false;
+	// the self steps (.) are dropped, an empty relative path selects the context node
+	vector<Step> steps;
+};
+
+namespace
+{
+using BlockHeader = XMLDocumentArena::BlockHeader;
+
+// arena used by the libxml2 allocations of this thread, nullptr means the heap
+thread_local XMLDocumentArena *currentArena = nullptr;
+atomic<bool> arenaHooksInstalled = false;
+// set by the entry points of this library that may reach libxml2: the hooks cannot be installed once it allocated its blocks
+atomic<bool> libxml2Used = false;
+
+void markLibxml2Used()
+{
+	if (!libxml2Used.load(memory_order_relaxed))
+		libxml2Used.store(true, memory_order_relaxed);
 }
 
-XMLWrapper::~XMLWrapper() { finish(); }
+void *heapMalloc(const size_t size)
+{
+	auto *header = static_cast<BlockHeader *>(malloc(sizeof(BlockHeader) + size));
+	if (header == nullptr)
+		return nullptr;
+	header->size = size;
+	header->arena = nullptr;
 
-void XMLWrapper::finish()
+	return header + 1;
+}
+
+void *arenaMalloc(const size_t size)
+{
+	if (currentArena != nullptr)
+		return currentArena->allocate(size);
+
+	return heapMalloc(size);
+}
+
+void arenaFree(void *pointer)
+{
+	if (pointer == nullptr)
+		return;
+
+	// a block of an arena is freed together with the arena
+	if (BlockHeader *header = static_cast<BlockHeader *>(pointer) - 1; header->arena == nullptr)
+		free(header);
+}
+
+void *arenaRealloc(void *pointer, const size_t size)
 {
-	if (_xpathCtx != nullptr)
+	if (pointer == nullptr)
+		return arenaMalloc(size);
+
+	BlockHeader *header = static_cast<BlockHeader *>(pointer) - 1;
+	if (header->arena == nullptr)
 	{
-		xmlXPathFreeContext(_xpathCtx);
-		_xpathCtx = nullptr;
+		auto *newHeader = static_cast<BlockHeader *>(realloc(header, sizeof(BlockHeader) + size));
+		if (newHeader == nullptr)
+			return nullptr;
+		newHeader->size = size;
+
+		return newHeader + 1;
 	}
-	if (_doc != nullptr)
+
+	// a block of an arena stays in its arena only inside the ArenaScope of its owner: XMLDocumentArena is not thread safe and
+	// a realloc may come from another thread (i.e. an XPath evaluation), then the block moves to the heap, freed by itself
+	void *newPointer = header->arena == currentArena ? header->arena->allocate(size) : heapMalloc(size);
+	if (newPointer != nullptr)
+		memcpy(newPointer, pointer, min(header->size, size));
+
+	return newPointer;
+}
+
+char *arenaStrdup(const char *source)
+{
+	const size_t size = strlen(source) + 1;
+	auto *copy = static_cast<char *>(arenaMalloc(size));
+	if (copy != nullptr)
+		memcpy(copy, source, size);
+
+	return copy;
+}
+
+// while in scope, the libxml2 allocations of this thread are done in arena (if not nullptr)
+class ArenaScope
+{
+  public:
+	explicit ArenaScope(XMLDocumentArena *arena) : _previousArena(currentArena), _active(arena != nullptr)
 	{
-		xmlFreeDoc(_doc);
-		_doc = nullptr;
+		if (_active)
+			currentArena = arena;
+	}
+
+	~ArenaScope()
+	{
+		if (!_active)
+			return;
+
+		// the last error of the thread may have been allocated in the arena, it must not survive it
+		xmlResetLastError();
+		currentArena = _previousArena;
 	}
+
+	ArenaScope(const ArenaScope &) = delete;
+	ArenaScope &operator=(const ArenaScope &) = delete;
+
+  private:
+	XMLDocumentArena *_previousArena;
+	bool _active;
+};
+
+using SimplePath = XMLWrapper::CompiledXPath::SimplePath;
+
+bool isNCName(string_view name)
+{
+	if (name.empty())
+		return false;
+	// the non ASCII bytes are accepted as they are, the expression is UTF-8
+	auto isNameStart = [](const unsigned char c) { return isalpha(c) || c == '_' || c >= 0x80; };
+	if (!isNameStart(name[0]))
+		return false;
+
+	return ranges::all_of(name.substr(1), [&](const unsigned char c) { return isNameStart(c) || isdigit(c) || c == '-' || c == '.'; });
 }
 
-void XMLWrapper::loadXML(
-	const string& url, int16_t timeoutInSeconds, const string& basicAuthenticationUser, const string& basicAuthenticationPassword,
-	int16_t maxRetryNumber, int16_t secondsToWaitBeforeToRetry, const vector<pair<string, string>>& nameServices
+bool parseQName(string_view qName, SimplePath::Step &step)
+{
+	const size_t colon = qName.find(':');
+	if (colon != string_view::npos)
+	{
+		if (!isNCName(qName.substr(0, colon)))
+			return false;
+		step.prefix = qName.substr(0, colon);
+		qName.remove_prefix(colon + 1);
+	}
+	if (!isNCName(qName))
+		return false;
+	step.name = qName;
+
+	return true;
+}
+
+bool parseSimpleStep(string_view text, SimplePath &simplePath)
+{
+	if (text == ".")
+		return true;
+
+	SimplePath::Step step;
+	if (text.starts_with('@'))
+	{
+		step.type = SimplePath::StepType::Attribute;
+		if (!parseQName(text.substr(1), step))
+			return false;
+		simplePath.steps.push_back(std::move(step));
+
+		return true;
+	}
+
+	if (text.ends_with(']'))
+	{
+		const size_t bracket = text.find('[');
+		if (bracket == string_view::npos)
+			return false;
+		const string_view position = text.substr(bracket + 1, text.size() - bracket - 2);
+		auto [end, errorCode] = from_chars(position.data(), position.data() + position.size(), step.position);
+		if (position.empty() || errorCode != errc() || end != position.data() + position.size() || step.position == 0)
+			return false;
+		text = text.substr(0, bracket);
+	}
+
+	if (text == "text()")
+		step.type = SimplePath::StepType::Text;
+	else if (text != "*" && !parseQName(text, step))
+		return false;
+	simplePath.steps.push_back(std::move(step));
+
+	return true;
+}
+
+// nullptr if the expression needs the XPath engine (other axes, functions, predicates other than a position, ...)
+unique_ptr<const SimplePath> parseSimplePath(string_view expression)
+{
+	auto simplePath = make_unique<SimplePath>();
+	if (expression.starts_with('/'))
+	{
+		simplePath->absolute = true;
+		expression.remove_prefix(1);
+	}
+	while (true)
+	{
+		// an empty step (//, a trailing /) is rejected by parseSimpleStep
+		const size_t separator = expression.find('/');
+		if (!parseSimpleStep(expression.substr(0, separator), *simplePath))
+			return nullptr;
+		if (separator == string_view::npos)
+			break;
+		expression.remove_prefix(separator + 1);
+	}
+	if (simplePath->absolute && simplePath->steps.empty())
+		return nullptr;
+	// the context of /@x or /text() is the document, which is not an xmlNode (no properties): left to the XPath engine
+	if (simplePath->absolute && simplePath->steps.front().type != SimplePath::StepType::Element)
+		return nullptr;
+	// attributes and text nodes have no children
+	for (size_t stepIndex = 0; stepIndex + 1 < simplePath->steps.size(); stepIndex++)
+	{
+		if (simplePath->steps[stepIndex].type != SimplePath::StepType::Element)
+			return nullptr;
+	}
+
+	return simplePath;
+}
+
+// same lookup of the XPath context: xml is predefined, otherwise the last registration of the prefix
+const xmlChar *namespaceURI(const vector<pair<string, string>> &nameServices, const string &prefix)
+{
+	if (prefix == "xml")
+		return XML_XML_NAMESPACE;
+	for (auto it = nameServices.rbegin(); it != nameServices.rend(); ++it)
+	{
+		if (it->first == prefix)
+			return BAD_CAST it->second.c_str();
+	}
+
+	return nullptr;
+}
+
+// an unprefixed name matches a node without namespace (an attribute without prefix), an unknown prefix matches nothing
+bool matchesName(const SimplePath::Step &step, const xmlChar *name, xmlNsPtr ns, const bool attribute, const vector<pair<string, string>> &nameServices)
+{
+	if (!xmlStrEqual(name, BAD_CAST step.name.c_str()))
+		return false;
+	if (step.prefix.empty())
+		return ns == nullptr || (attribute && ns->prefix == nullptr);
+
+	const xmlChar *uri = namespaceURI(nameServices, step.prefix);
+
+	return ns != nullptr && uri != nullptr && xmlStrEqual(ns->href, uri);
+}
+
+bool matchesStep(const SimplePath::Step &step, xmlNodePtr node, const vector<pair<string, string>> &nameServices)
+{
+	if (step.type == SimplePath::StepType::Text)
+		return node->type == XML_TEXT_NODE || node->type == XML_CDATA_SECTION_NODE;
+	if (node->type != XML_ELEMENT_NODE)
+		return false;
+
+	return step.name.empty() || matchesName(step, node->name, node->ns, false, nameServices);
+}
+
+// calls onNode for every selected node, in document order, until it returns false
+template <typename OnNode>
+bool walkSimplePath(
+	const SimplePath &simplePath, const size_t stepIndex, xmlNodePtr node, const vector<pair<string, string>> &nameServices, OnNode &onNode
 )
 {
-	try
+	if (stepIndex == simplePath.steps.size())
+		return onNode(node);
+
+	// as in the XPath engine, the content of an attribute is not a child
+	if (node->type != XML_ELEMENT_NODE && node->type != XML_DOCUMENT_NODE)
+		return true;
+
+	const SimplePath::Step &step = simplePath.steps[stepIndex];
+	if (step.type == SimplePath::StepType::Attribute)
 	{
-		finish();
+		// an element has at most one attribute with a given (expanded) name
+		for (xmlAttrPtr attribute = node->properties; attribute != nullptr; attribute = attribute->next)
+		{
+			if (matchesName(step, attribute->name, attribute->ns, true, nameServices))
+				return onNode(reinterpret_cast<xmlNodePtr>(attribute));
+		}
 
-		CurlWrapper::GetInputParameters inputParameters {
-			.url = url,
-			.timeoutInSeconds = timeoutInSeconds,
-			.authorization = CurlWrapper::basicAuthorization(basicAuthenticationUser, basicAuthenticationPassword),
-			.maxRetryNumber = maxRetryNumber,
-			.secondsToWaitBeforeToRetry = secondsToWaitBeforeToRetry
-		};
-		CurlWrapper::OutputParameters outputParameters;
-		_sourceXML = CurlWrapper::httpGet(inputParameters, outputParameters);
-		_eTag = outputParameters.getResponseHeaderValue("ETag");
+		return true;
+	}
 
-		/*
-		 * The document being in memory, it have no base per RFC 2396,
-		 * and the "noname.xml" argument will serve as its base.
-		 */
-		/*
-		This is an annoying failure of the libXml library. As noted by cateof, the problem is the default namespace declaration:
-		xmlns="http://www.example.com/new"
-		Two choices:
-		(1) get rid of that declaration in your book tag or (2) give it a name, and use that name in your tags.
-		*/
-		string xml = _sourceXML;
-		// xml = StringUtils::replaceAll(xml, "xmlns=", "xmlns:mio=");
-		_doc = xmlReadMemory(xml.c_str(), xml.size(), "noname.xml", "UTF-8", 0);
-		// doc = xmlParseFile("/var/log/cms/dump.xml");
-		if (_doc == nullptr)
+	size_t matched = 0;
+	for (xmlNodePtr child = node->children; child != nullptr; child = child->next)
+	{
+		if (!matchesStep(step, child, nameServices) || (step.position != 0 && ++matched != step.position))
+			continue;
+		if (!walkSimplePath(simplePath, stepIndex + 1, child, nameServices, onNode))
+			return false;
+		if (step.position != 0)
+			break;
+	}
+
+	return true;
+}
+
+// the context node of evalXPath, nullptr for an empty document
+xmlNodePtr simplePathContext(const SimplePath &simplePath, xmlDocPtr doc, xmlNodePtr startingNode)
+{
+	if (simplePath.absolute)
+		return reinterpret_cast<xmlNodePtr>(doc);
+
+	return startingNode == nullptr ? xmlDocGetRootElement(doc) : startingNode;
+}
+
+// the nodes selected by an expression with a predicate (i.e. //item[@type='a']) may change with their attributes,
+// an attribute index on it cannot be updated node by node
+bool selectsByPredicate(const string &xPathExpression) { return xPathExpression.find('[') != string::npos; }
+
+class XPathCache
+{
+  public:
+	XMLWrapper::PreparedXPath get(const string &xPathExpression)
+	{
 		{
-			string errorMessage = std::format(
-				"The xmlReadMemory failed"
-				", url: {}",
-				url
-			);
-			LOG_ERROR(errorMessage);
+			lock_guard<mutex> locker(_mutex);
+
+			if (auto it = _entries.find(xPathExpression); it != _entries.end())
+			{
+				_hits++;
+				_lru.splice(_lru.begin(), _lru, it->second);
+				return *(it->second);
+			}
+			_misses++;
+		}
+
+		// the compilation is done outside the lock, two threads missing the same expression simply compile it twice
+		xmlXPathCompExprPtr compExpr = xmlXPathCompile(BAD_CAST xPathExpression.c_str());
+		if (compExpr == nullptr)
+			return nullptr;
+		auto preparedXPath = make_shared<const XMLWrapper::CompiledXPath>(xPathExpression, compExpr);
+
+		lock_guard<mutex> locker(_mutex);
+
+		if (auto it = _entries.find(xPathExpression); it != _entries.end())
+			return *(it->second);
+		if (_capacity == 0)
+			return preparedXPath;
+
+		_lru.push_front(preparedXPath);
+		_entries.emplace(preparedXPath->expression, _lru.begin());
+		evict();
+
+		return preparedXPath;
+	}
+
+	XMLWrapper::XPathCacheStats stats()
+	{
+		lock_guard<mutex> locker(_mutex);
+
+		return XMLWrapper::XPathCacheStats{.hits = _hits, .misses = _misses, .evictions = _evictions, .size = _entries.size(), .capacity = _capacity};
+	}
+
+	void setCapacity(size_t capacity)
+	{
+		lock_guard<mutex> locker(_mutex);
+
+		_capacity = capacity;
+		evict();
+	}
+
+	void clear()
+	{
+		lock_guard<mutex> locker(_mutex);
+
+		// handles already returned to the callers keep their expression alive
+		_entries.clear();
+		_lru.clear();
+	}
+
+	vector<XMLWrapper::PreparedXPath> entries()
+	{
+		lock_guard<mutex> locker(_mutex);
+
+		return {_lru.begin(), _lru.end()};
+	}
+
+  private:
+	mutex _mutex;
+	list<XMLWrapper::PreparedXPath> _lru;
+	// the key refers to the expression owned by the CompiledXPath in _lru
+	unordered_map<string_view, list<XMLWrapper::PreparedXPath>::iterator> _entries;
+	size_t _capacity = 1024;
+	uint64_t _hits = 0;
+	uint64_t _misses = 0;
+	uint64_t _evictions = 0;
+
+	void evict()
+	{
+		while (_entries.size() > _capacity)
+		{
+			_entries.erase(_lru.back()->expression);
+			_lru.pop_back();
+			_evictions++;
+		}
+	}
+};
+
+XPathCache &xPathCache()
+{
+	static XPathCache cache;
+	return cache;
+}
+
+// process-wide, see XMLWrapper::enableMetrics
+atomic<bool> metricsEnabled = false;
+
+class LatencyMetric
+{
+  public:
+	void record(const chrono::steady_clock::duration elapsed)
+	{
+		const auto nanoseconds = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+		const size_t bucket =
+			ranges::lower_bound(XMLWrapper::latencyBucketBounds, (nanoseconds + 999) / 1000) - XMLWrapper::latencyBucketBounds.begin();
+		_buckets[bucket].fetch_add(1, memory_order_relaxed);
+		_count.fetch_add(1, memory_order_relaxed);
+		_nanoseconds.fetch_add(nanoseconds, memory_order_relaxed);
+	}
+
+	[[nodiscard]] XMLWrapper::LatencyHistogram snapshot() const
+	{
+		XMLWrapper::LatencyHistogram histogram;
+		for (size_t bucket = 0; bucket < _buckets.size(); bucket++)
+			histogram.buckets[bucket] = _buckets[bucket].load(memory_order_relaxed);
+		histogram.count = _count.load(memory_order_relaxed);
+		histogram.seconds = static_cast<double>(_nanoseconds.load(memory_order_relaxed)) / 1e9;
+
+		return histogram;
+	}
+
+	void reset()
+	{
+		for (atomic<uint64_t> &bucket : _buckets)
+			bucket = 0;
+		_count = 0;
+		_nanoseconds = 0;
+	}
+
+  private:
+	array<atomic<uint64_t>, XMLWrapper::latencyBucketBounds.size() + 1> _buckets{};
+	atomic<uint64_t> _count = 0;
+	atomic<uint64_t> _nanoseconds = 0;
+};
+
+struct MetricsRegistry
+{
+	LatencyMetric download;
+	LatencyMetric parse;
+	LatencyMetric xPath;
+	LatencyMetric serialization;
+	atomic<uint64_t> downloadedBytes = 0;
+	atomic<uint64_t> parsedBytes = 0;
+	atomic<uint64_t> parsedNodes = 0;
+	atomic<uint64_t> serializedBytes = 0;
+	atomic<uint64_t> xPathMisses = 0;
+	atomic<uint64_t> selectedNodes = 0;
+};
+
+MetricsRegistry &metricsRegistry()
+{
+	static MetricsRegistry registry;
+	return registry;
+}
+
+void countMetric(atomic<uint64_t> MetricsRegistry::*counter, const uint64_t value)
+{
+	if (metricsEnabled.load(memory_order_relaxed))
+		(metricsRegistry().*counter).fetch_add(value, memory_order_relaxed);
+}
+
+// a miss is an evaluation giving nothing to the caller: no node selected, or a result that is not a node set (i.e. count()),
+// discarded by evalXPath as the XPath API of XMLWrapper deals only with nodes
+void recordXPathEvaluation(
+	const XMLWrapper::CompiledXPath &compiledXPath, const chrono::steady_clock::duration elapsed, const bool miss, const uint64_t selectedNodes
+)
+{
+	metricsRegistry().xPath.record(elapsed);
+	compiledXPath.evaluations.fetch_add(1, memory_order_relaxed);
+	compiledXPath.nanoseconds.fetch_add(chrono::duration_cast<chrono::nanoseconds>(elapsed).count(), memory_order_relaxed);
+	if (miss)
+	{
+		compiledXPath.misses.fetch_add(1, memory_order_relaxed);
+		countMetric(&MetricsRegistry::xPathMisses, 1);
+	}
+	else
+		countMetric(&MetricsRegistry::selectedNodes, selectedNodes);
+}
+
+// the scope is timed only if the metrics are enabled
+class MetricTimer
+{
+  public:
+	explicit MetricTimer(LatencyMetric MetricsRegistry::*metric)
+		: _metric(metricsEnabled.load(memory_order_relaxed) ? &(metricsRegistry().*metric) : nullptr)
+	{
+		if (_metric != nullptr)
+			_start = chrono::steady_clock::now();
+	}
+
+	~MetricTimer()
+	{
+		if (_metric != nullptr)
+			_metric->record(chrono::steady_clock::now() - _start);
+	}
+
+	MetricTimer(const MetricTimer &) = delete;
+	MetricTimer &operator=(const MetricTimer &) = delete;
+
+  private:
+	LatencyMetric *_metric;
+	chrono::steady_clock::time_point _start;
+};
+
+// elements, attributes and text nodes of the document
+uint64_t countNodes(xmlDocPtr doc)
+{
+	uint64_t nodes = 0;
+	xmlNodePtr node = doc->children;
+	while (node != nullptr)
+	{
+		nodes++;
+		if (node->type == XML_ELEMENT_NODE)
+			for (xmlAttrPtr attribute = node->properties; attribute != nullptr; attribute = attribute->next)
+				nodes++;
+		if (node->type == XML_ELEMENT_NODE && node->children != nullptr)
+		{
+			node = node->children;
+			continue;
+		}
+		while (node != nullptr && node->next == nullptr)
+			node = node->parent == reinterpret_cast<xmlNodePtr>(doc) ? nullptr : node->parent;
+		if (node != nullptr)
+			node = node->next;
+	}
+
+	return nodes;
+}
+
+void appendHistogram(string &text, const string &name, const string &help, const XMLWrapper::LatencyHistogram &histogram)
+{
+	text += std::format("# HELP {} {}\n# TYPE {} histogram\n", name, help, name);
+	uint64_t cumulative = 0;
+	for (size_t bucket = 0; bucket < XMLWrapper::latencyBucketBounds.size(); bucket++)
+	{
+		cumulative += histogram.buckets[bucket];
+		text += std::format("{}_bucket{{le=\"{}\"}} {}\n", name, static_cast<double>(XMLWrapper::latencyBucketBounds[bucket]) / 1e6, cumulative);
+	}
+	text += std::format("{}_bucket{{le=\"+Inf\"}} {}\n{}_sum {}\n{}_count {}\n", name, histogram.count, name, histogram.seconds, name, histogram.count);
+}
+
+void appendCounter(string &text, const string &name, const string &help, const uint64_t value)
+{
+	text += std::format("# HELP {} {}\n# TYPE {} counter\n{} {}\n", name, help, name, name, value);
+}
+
+// label value escaping of the exposition format
+string escapeLabel(string_view value)
+{
+	string escaped;
+	escaped.reserve(value.size());
+	for (const char c : value)
+	{
+		if (c == '\\' || c == '"')
+			escaped += '\\';
+		if (c == '\n')
+			escaped += "\\n";
+		else
+			escaped += c;
+	}
+
+	return escaped;
+}
+
+XMLWrapper::Compression detectCompression(string_view head)
+{
+	if (head.size() >= 2 && static_cast<unsigned char>(head[0]) == 0x1f && static_cast<unsigned char>(head[1]) == 0x8b)
+		return XMLWrapper::Compression::Gzip;
+	if (head.size() >= 4 && head.substr(0, 4) == "\x28\xb5\x2f\xfd"sv)
+		return XMLWrapper::Compression::Zstd;
+	if (head.size() >= 6 && head.substr(0, 6) == "\xfd" "7zXZ\0"sv)
+		return XMLWrapper::Compression::Xz;
+
+	return XMLWrapper::Compression::None;
+}
+
+// streaming decompression: every call passes the decompressed blocks to output as soon as they are available
+class Decompressor
+{
+  public:
+	explicit Decompressor(XMLWrapper::Compression compression) : _compression(compression), _buffer(64 * 1024)
+	{
+		bool initialized = false;
+		switch (_compression)
+		{
+		case XMLWrapper::Compression::Gzip:
+			// 15 + 32: zlib or gzip header automatically detected
+			initialized = inflateInit2(&_zStream, 15 + 32) == Z_OK;
+			break;
+		case XMLWrapper::Compression::Zstd:
+			_zstdStream = ZSTD_createDStream();
+			initialized = _zstdStream != nullptr;
+			break;
+		case XMLWrapper::Compression::Xz:
+			initialized = lzma_stream_decoder(&_lzmaStream, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+			break;
+		default:
+			break;
+		}
+		if (!initialized)
+			throw runtime_error(std::format("decompressor initialization failed, compression: {}", static_cast<int>(_compression)));
+	}
+
+	~Decompressor()
+	{
+		if (_compression == XMLWrapper::Compression::Gzip)
+			inflateEnd(&_zStream);
+		else if (_compression == XMLWrapper::Compression::Zstd)
+			ZSTD_freeDStream(_zstdStream);
+		else if (_compression == XMLWrapper::Compression::Xz)
+			lzma_end(&_lzmaStream);
+	}
+
+	Decompressor(const Decompressor &) = delete;
+	Decompressor &operator=(const Decompressor &) = delete;
+
+	void decompress(string_view input, const function<void(string_view)> &output)
+	{
+		if (_compression == XMLWrapper::Compression::Gzip)
+		{
+			// avail_in is 32 bits: an input over 4 GB is inflated in slices
+			size_t offset = 0;
+			do
+			{
+				const string_view slice = input.substr(offset, numeric_limits<uInt>::max());
+				offset += slice.size();
+				inflateSlice(slice, output);
+			} while (offset < input.size());
+		}
+		else if (_compression == XMLWrapper::Compression::Zstd)
+		{
+			ZSTD_inBuffer in{input.data(), input.size(), 0};
+			while (true)
+			{
+				ZSTD_outBuffer out{_buffer.data(), _buffer.size(), 0};
+				size_t ret = ZSTD_decompressStream(_zstdStream, &out, &in);
+				if (ZSTD_isError(ret))
+					throw runtime_error(std::format("ZSTD_decompressStream failed: {}", ZSTD_getErrorName(ret)));
+				if (out.pos > 0)
+					output(string_view(_buffer.data(), out.pos));
+				_streamEnd = ret == 0;
+				if (in.pos == in.size && out.pos < out.size)
+					break;
+			}
+		}
+		else
+		{
+			_lzmaStream.next_in = reinterpret_cast<const uint8_t *>(input.data());
+			_lzmaStream.avail_in = input.size();
+			lzmaCode(LZMA_RUN, output);
+		}
+	}
+
+	// checks that the compressed stream is complete, flushing the last blocks
+	void finish(const function<void(string_view)> &output)
+	{
+		if (_compression == XMLWrapper::Compression::Xz)
+		{
+			_lzmaStream.next_in = nullptr;
+			_lzmaStream.avail_in = 0;
+			lzmaCode(LZMA_FINISH, output);
+		}
+		if (!_streamEnd)
+			throw runtime_error("compressed stream truncated");
+	}
+
+  private:
+	XMLWrapper::Compression _compression;
+	vector<char> _buffer;
+	z_stream _zStream{};
+	ZSTD_DStream *_zstdStream = nullptr;
+	lzma_stream _lzmaStream = LZMA_STREAM_INIT;
+	bool _streamEnd = false;
+
+	void inflateSlice(string_view input, const function<void(string_view)> &output)
+	{
+		_zStream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+		_zStream.avail_in = static_cast<uInt>(input.size());
+		do
+		{
+			// concatenated gzip members
+			if (_streamEnd && _zStream.avail_in > 0)
+			{
+				inflateReset(&_zStream);
+				_streamEnd = false;
+			}
+			_zStream.next_out = reinterpret_cast<Bytef *>(_buffer.data());
+			_zStream.avail_out = static_cast<uInt>(_buffer.size());
+			int ret = inflate(&_zStream, Z_NO_FLUSH);
+			if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+				throw runtime_error(std::format("inflate failed, ret: {}", ret));
+			if (size_t produced = _buffer.size() - _zStream.avail_out; produced > 0)
+				output(string_view(_buffer.data(), produced));
+			if (ret == Z_STREAM_END)
+				_streamEnd = true;
+			else if (ret == Z_BUF_ERROR)
+				break;
+		} while (_zStream.avail_in > 0 || _zStream.avail_out == 0);
+	}
+
+	void lzmaCode(lzma_action action, const function<void(string_view)> &output)
+	{
+		do
+		{
+			_lzmaStream.next_out = reinterpret_cast<uint8_t *>(_buffer.data());
+			_lzmaStream.avail_out = _buffer.size();
+			lzma_ret ret = lzma_code(&_lzmaStream, action);
+			if (ret != LZMA_OK && ret != LZMA_STREAM_END)
+				throw runtime_error(std::format("lzma_code failed, ret: {}", static_cast<int>(ret)));
+			if (size_t produced = _buffer.size() - _lzmaStream.avail_out; produced > 0)
+				output(string_view(_buffer.data(), produced));
+			if (ret == LZMA_STREAM_END)
+			{
+				_streamEnd = true;
+				break;
+			}
+		} while (_lzmaStream.avail_in > 0 || _lzmaStream.avail_out == 0 || action == LZMA_FINISH);
+	}
+};
+
+class Compressor
+{
+  public:
+	explicit Compressor(XMLWrapper::Compression compression) : _compression(compression), _buffer(64 * 1024)
+	{
+		bool initialized = false;
+		switch (_compression)
+		{
+		case XMLWrapper::Compression::Gzip:
+			// 15 + 16: gzip header
+			initialized = deflateInit2(&_zStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+			break;
+		case XMLWrapper::Compression::Zstd:
+			_zstdContext = ZSTD_createCCtx();
+			initialized = _zstdContext != nullptr;
+			break;
+		case XMLWrapper::Compression::Xz:
+			initialized = lzma_easy_encoder(&_lzmaStream, 6, LZMA_CHECK_CRC64) == LZMA_OK;
+			break;
+		default:
+			break;
+		}
+		if (!initialized)
+			throw runtime_error(std::format("compressor initialization failed, compression: {}", static_cast<int>(_compression)));
+	}
+
+	~Compressor()
+	{
+		if (_compression == XMLWrapper::Compression::Gzip)
+			deflateEnd(&_zStream);
+		else if (_compression == XMLWrapper::Compression::Zstd)
+			ZSTD_freeCCtx(_zstdContext);
+		else if (_compression == XMLWrapper::Compression::Xz)
+			lzma_end(&_lzmaStream);
+	}
+
+	Compressor(const Compressor &) = delete;
+	Compressor &operator=(const Compressor &) = delete;
+
+	void compress(string_view input, const function<void(string_view)> &output) { code(input, false, output); }
+
+	void finish(const function<void(string_view)> &output) { code({}, true, output); }
+
+  private:
+	XMLWrapper::Compression _compression;
+	vector<char> _buffer;
+	z_stream _zStream{};
+	ZSTD_CCtx *_zstdContext = nullptr;
+	lzma_stream _lzmaStream = LZMA_STREAM_INIT;
+
+	void code(string_view input, const bool end, const function<void(string_view)> &output)
+	{
+		if (_compression == XMLWrapper::Compression::Gzip)
+		{
+			// avail_in is 32 bits: an input over 4 GB is deflated in slices, the stream ends with the last one
+			size_t offset = 0;
+			do
+			{
+				const string_view slice = input.substr(offset, numeric_limits<uInt>::max());
+				offset += slice.size();
+				const bool last = end && offset == input.size();
+				_zStream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(slice.data()));
+				_zStream.avail_in = static_cast<uInt>(slice.size());
+				int ret;
+				do
+				{
+					_zStream.next_out = reinterpret_cast<Bytef *>(_buffer.data());
+					_zStream.avail_out = static_cast<uInt>(_buffer.size());
+					ret = deflate(&_zStream, last ? Z_FINISH : Z_NO_FLUSH);
+					if (ret == Z_STREAM_ERROR)
+						throw runtime_error("deflate failed");
+					if (size_t produced = _buffer.size() - _zStream.avail_out; produced > 0)
+						output(string_view(_buffer.data(), produced));
+				} while (_zStream.avail_out == 0 || (last && ret != Z_STREAM_END));
+			} while (offset < input.size());
+		}
+		else if (_compression == XMLWrapper::Compression::Zstd)
+		{
+			ZSTD_inBuffer in{input.data(), input.size(), 0};
+			size_t remaining;
+			do
+			{
+				ZSTD_outBuffer out{_buffer.data(), _buffer.size(), 0};
+				remaining = ZSTD_compressStream2(_zstdContext, &out, &in, end ? ZSTD_e_end : ZSTD_e_continue);
+				if (ZSTD_isError(remaining))
+					throw runtime_error(std::format("ZSTD_compressStream2 failed: {}", ZSTD_getErrorName(remaining)));
+				if (out.pos > 0)
+					output(string_view(_buffer.data(), out.pos));
+			} while (in.pos < in.size || (end && remaining != 0));
+		}
+		else
+		{
+			_lzmaStream.next_in = reinterpret_cast<const uint8_t *>(input.data());
+			_lzmaStream.avail_in = input.size();
+			lzma_ret ret;
+			do
+			{
+				_lzmaStream.next_out = reinterpret_cast<uint8_t *>(_buffer.data());
+				_lzmaStream.avail_out = _buffer.size();
+				ret = lzma_code(&_lzmaStream, end ? LZMA_FINISH : LZMA_RUN);
+				if (ret != LZMA_OK && ret != LZMA_STREAM_END)
+					throw runtime_error(std::format("lzma_code failed, ret: {}", static_cast<int>(ret)));
+				if (size_t produced = _buffer.size() - _lzmaStream.avail_out; produced > 0)
+					output(string_view(_buffer.data(), produced));
+			} while (_lzmaStream.avail_in > 0 || _lzmaStream.avail_out == 0 || (end && ret != LZMA_STREAM_END));
+		}
+	}
+};
+
+// the dictionary of a parser context is replaced (i.e. by a sub-dictionary of the shared one): the names the parser
+// compares by pointer have to be looked up again in the new dictionary
+void setDictionary(xmlParserCtxtPtr parserCtxt, xmlDictPtr dict)
+{
+	if (parserCtxt->dict != nullptr)
+		xmlDictFree(parserCtxt->dict);
+	parserCtxt->dict = dict;
+	parserCtxt->str_xml = xmlDictLookup(dict, BAD_CAST "xml", 3);
+	parserCtxt->str_xmlns = xmlDictLookup(dict, BAD_CAST "xmlns", 5);
+	parserCtxt->str_xml_ns = xmlDictLookup(dict, XML_XML_NAMESPACE, 36);
+}
+
+// push parser fed chunk by chunk: the first bytes decide if the chunks have to be decompressed before being parsed
+class ChunkParser
+{
+  public:
+	// dict (optional) is owned by the parser and becomes the dictionary of the document,
+	// arena (optional) is where the parser and the document are allocated.
+	// With a SAX handler (sax, userData) no document is built, only the handler is called
+	ChunkParser(const int parserOptions, xmlDictPtr dict, XMLDocumentArena *arena, xmlSAXHandlerPtr sax = nullptr, void *userData = nullptr)
+		: _arena(arena), _sax(sax != nullptr), _recover((parserOptions & XML_PARSE_RECOVER) != 0)
+	{
+		ArenaScope arenaScope(_arena);
+
+		_parserCtxt = xmlCreatePushParserCtxt(sax, userData, nullptr, 0, "noname.xml");
+		if (_parserCtxt == nullptr)
+		{
+			if (dict != nullptr)
+				xmlDictFree(dict);
+			throw runtime_error("xmlCreatePushParserCtxt failed");
+		}
+		if (dict != nullptr)
+			setDictionary(_parserCtxt, dict);
+		// the declared encoding is ignored, the input is UTF-8 as the "UTF-8" passed to xmlReadMemory/xmlReadFile on the other paths:
+		// a document is decoded the same whatever loads it (an encoding set on a push parser context is overridden by the declaration)
+		xmlCtxtUseOptions(_parserCtxt, parserOptions | XML_PARSE_IGNORE_ENC);
+	}
+
+	~ChunkParser()
+	{
+		ArenaScope arenaScope(_arena);
+
+		if (_parserCtxt->myDoc != nullptr)
+			xmlFreeDoc(_parserCtxt->myDoc);
+		xmlFreeParserCtxt(_parserCtxt);
+	}
+
+	ChunkParser(const ChunkParser &) = delete;
+	ChunkParser &operator=(const ChunkParser &) = delete;
+
+	// return false as soon as the document is known to be not well formed (or not decompressable), the caller can stop reading
+	bool parse(string_view chunk)
+	{
+		if (_failed)
+			return false;
+
+		ArenaScope arenaScope(_arena);
+		try
+		{
+			if (_headChecked)
+				feed(chunk);
+			else
+			{
+				// the longest magic number (xz) is 6 bytes
+				_head.append(chunk);
+				if (_head.size() >= 6)
+					checkHead();
+			}
+		}
+		catch (const exception &e)
+		{
+			LOG_ERROR(
+				"decompression failed"
+				", exception: {}",
+				e.what()
+			);
+			_failed = true;
+		}
+
+		return !_failed;
+	}
+
+	// return the parsed document, owned by the caller, or nullptr if it is not well formed (and not recovered)
+	xmlDocPtr finish()
+	{
+		if (!complete())
+			return nullptr;
+
+		xmlDocPtr doc = _parserCtxt->myDoc;
+		_parserCtxt->myDoc = nullptr;
+
+		return doc;
+	}
+
+	// end of the input, return false if the document is not well formed.
+	// With XML_PARSE_RECOVER, as xmlReadMemory does, what was parsed is kept: false only if no document was built at all
+	bool complete()
+	{
+		ArenaScope arenaScope(_arena);
+		try
+		{
+			if (!_failed && !_headChecked)
+				checkHead();
+			if (!_failed && _decompressor)
+				_decompressor->finish([this](string_view data) { parseChunk(data); });
+		}
+		catch (const exception &e)
+		{
+			LOG_ERROR(
+				"decompression failed"
+				", exception: {}",
+				e.what()
+			);
+			_failed = true;
+		}
+		if (_failed)
+			return false;
+
+		xmlParseChunk(_parserCtxt, nullptr, 0, 1);
+
+		return _parserCtxt->wellFormed || (_recover && (_sax || _parserCtxt->myDoc != nullptr));
+	}
+
+	[[nodiscard]] xmlParserCtxtPtr context() const { return _parserCtxt; }
+
+  private:
+	xmlParserCtxtPtr _parserCtxt = nullptr;
+	XMLDocumentArena *_arena;
+	bool _sax;
+	bool _recover;
+	unique_ptr<Decompressor> _decompressor;
+	string _head;
+	bool _headChecked = false;
+	bool _failed = false;
+
+	void checkHead()
+	{
+		_headChecked = true;
+		if (XMLWrapper::Compression compression = detectCompression(_head); compression != XMLWrapper::Compression::None)
+			_decompressor = make_unique<Decompressor>(compression);
+
+		string head = std::move(_head);
+		feed(head);
+	}
+
+	void feed(string_view chunk)
+	{
+		if (_decompressor)
+			_decompressor->decompress(chunk, [this](string_view data) { parseChunk(data); });
+		else
+			parseChunk(chunk);
+	}
+
+	// an error stops the parsing unless the parser recovers from it, then xmlParseChunk keeps returning it and the chunks are fed anyway
+	void parseChunk(string_view data)
+	{
+		if (!_failed && xmlParseChunk(_parserCtxt, data.data(), static_cast<int>(data.size()), 0) != 0 && !_recover)
+			_failed = true;
+	}
+};
+
+// xmlTextReader input decompressing the chunks returned by next (an empty chunk means end of input)
+struct DecompressingInput
+{
+	function<string_view()> next;
+	Decompressor decompressor;
+	string pending;
+	size_t offset = 0;
+	bool eof = false;
+
+	DecompressingInput(function<string_view()> next, XMLWrapper::Compression compression) : next(std::move(next)), decompressor(compression) {}
+
+	static int read(void *context, char *buffer, int len)
+	{
+		auto *input = static_cast<DecompressingInput *>(context);
+		try
+		{
+			auto append = [input](string_view data) { input->pending.append(data); };
+			while (input->offset == input->pending.size() && !input->eof)
+			{
+				input->pending.clear();
+				input->offset = 0;
+				string_view chunk = input->next();
+				if (chunk.empty())
+				{
+					input->decompressor.finish(append);
+					input->eof = true;
+				}
+				else
+					input->decompressor.decompress(chunk, append);
+			}
+
+			size_t copied = min(static_cast<size_t>(len), input->pending.size() - input->offset);
+			memcpy(buffer, input->pending.data() + input->offset, copied);
+			input->offset += copied;
+
+			return static_cast<int>(copied);
+		}
+		catch (const exception &e)
+		{
+			LOG_ERROR(
+				"decompression failed"
+				", exception: {}",
+				e.what()
+			);
+
+			return -1;
+		}
+	}
+};
+
+void writeAll(int fd, string_view data, const string &pathName)
+{
+	while (!data.empty())
+	{
+		ssize_t written = write(fd, data.data(), data.size());
+		if (written == -1 && errno == EINTR)
+			continue;
+		if (written == -1)
+		{
+			string errorMessage = std::format(
+				"write failed"
+				", pathName: {}"
+				", errno: {}",
+				pathName, errno
+			);
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+		data.remove_prefix(written);
+	}
+}
+
+// SAX2 handler of the bindings: outside a record only the position in the record path is tracked, inside a record
+// the position in the tree of the field paths. The subtrees out of both only move the depth counter
+class BindingParser
+{
+  public:
+	explicit BindingParser(const XMLBindingTarget &target) : _target(target)
+	{
+		_recordPathSteps = pathSteps(target.recordPath);
+		if (!target.recordPath.starts_with('/') || _recordPathSteps.empty())
+			throw runtime_error(std::format("recordPath has to be an absolute path of elements, recordPath: {}", target.recordPath));
+
+		// node 0 is the record element
+		_pathNodes.emplace_back();
+		for (size_t fieldIndex = 0; fieldIndex < target.fieldPaths.size(); fieldIndex++)
+		{
+			string_view path = target.fieldPaths[fieldIndex];
+			string_view attributeName;
+			if (size_t at = path.rfind('@'); at != string_view::npos)
+			{
+				attributeName = path.substr(at + 1);
+				path = path.substr(0, at);
+			}
+			size_t pathNode = 0;
+			for (const string &step : pathSteps(path))
+			{
+				if (step == ".")
+					continue;
+				auto child = ranges::find_if(_pathNodes[pathNode].children, [&step](const auto &child) { return child.first == step; });
+				if (child != _pathNodes[pathNode].children.end())
+					pathNode = child->second;
+				else
+				{
+					_pathNodes[pathNode].children.emplace_back(step, _pathNodes.size());
+					pathNode = _pathNodes.size();
+					_pathNodes.emplace_back();
+				}
+			}
+			if (attributeName.empty())
+				_pathNodes[pathNode].textFields.push_back(fieldIndex);
+			else
+				_pathNodes[pathNode].attributeFields.emplace_back(attributeName, fieldIndex);
+		}
+		_assigned.resize(target.fieldPaths.size());
+	}
+
+	void setParserContext(xmlParserCtxtPtr parserCtxt) { _parserCtxt = parserCtxt; }
+	[[nodiscard]] size_t records() const { return _records; }
+	[[nodiscard]] size_t malformedValues() const { return _malformedValues; }
+	// exception thrown by the target, the parser was stopped
+	void rethrow() const
+	{
+		if (_exception)
+			rethrow_exception(_exception);
+	}
+
+	static xmlSAXHandler handler()
+	{
+		xmlSAXHandler sax{};
+		// no startDocument/entity declarations: nothing is built, only the predefined and character entities are resolved
+		sax.initialized = XML_SAX2_MAGIC;
+		sax.startElementNs = startElement;
+		sax.endElementNs = endElement;
+		sax.characters = characters;
+		sax.cdataBlock = characters;
+
+		return sax;
+	}
+
+  private:
+	struct PathNode
+	{
+		vector<pair<string, size_t>> children; // element name, path node
+		vector<size_t> textFields;
+		vector<pair<string, size_t>> attributeFields; // attribute name, field
+	};
+
+	const XMLBindingTarget &_target;
+	xmlParserCtxtPtr _parserCtxt = nullptr;
+	vector<string> _recordPathSteps;
+	vector<PathNode> _pathNodes;
+	size_t _depth = 0;
+	// open elements matching the record path, outside a record
+	size_t _matchedDepth = 0;
+	// depth of the skipped subtree being parsed, 0 if none
+	size_t _skipDepth = 0;
+	// path nodes of the open elements of the record, and their text (only for the ones having text fields)
+	vector<size_t> _pathNodesStack;
+	vector<string> _texts;
+	vector<bool> _assigned;
+	size_t _records = 0;
+	size_t _malformedValues = 0;
+	exception_ptr _exception;
+
+	static vector<string> pathSteps(string_view path)
+	{
+		vector<string> steps;
+		for (size_t start = 0; start < path.size();)
+		{
+			size_t end = min(path.find('/', start), path.size());
+			if (end > start)
+				steps.emplace_back(path.substr(start, end - start));
+			start = end + 1;
+		}
+
+		return steps;
+	}
+
+	// the step matches the local name or the prefixed name
+	static bool nameMatches(const string &step, const xmlChar *localName, const xmlChar *prefix)
+	{
+		if (xmlStrEqual(BAD_CAST step.c_str(), localName))
+			return true;
+		if (prefix == nullptr)
+			return false;
+		const size_t prefixLength = xmlStrlen(prefix);
+
+		return step.size() > prefixLength && step[prefixLength] == ':' && step.compare(0, prefixLength, reinterpret_cast<const char *>(prefix)) == 0 &&
+			   xmlStrEqual(BAD_CAST step.c_str() + prefixLength + 1, localName);
+	}
+
+	void assign(const size_t fieldIndex, string_view value)
+	{
+		if (_assigned[fieldIndex])
+			return;
+		_assigned[fieldIndex] = true;
+		if (!_target.assign(fieldIndex, value))
+			_malformedValues++;
+	}
+
+	void enter(const size_t pathNode, const int attributesNumber, const xmlChar **attributes)
+	{
+		_pathNodesStack.push_back(pathNode);
+		if (_texts.size() < _pathNodesStack.size())
+			_texts.resize(_pathNodesStack.size());
+		_texts[_pathNodesStack.size() - 1].clear();
+
+		// localname, prefix, URI, value, end for every attribute
+		for (const auto &[attributeName, fieldIndex] : _pathNodes[pathNode].attributeFields)
+		{
+			for (int attributeIndex = 0; attributeIndex < attributesNumber; attributeIndex++)
+			{
+				const xmlChar **attribute = attributes + attributeIndex * 5;
+				if (!nameMatches(attributeName, attribute[0], attribute[1]))
+					continue;
+
+				const auto *value = reinterpret_cast<const char *>(attribute[3]);
+				const auto length = static_cast<int>(attribute[4] - attribute[3]);
+				// without entity substitution a reference is left in the value (i.e. &amp; as &#38;)
+				if (memchr(value, '&', length) == nullptr)
+					assign(fieldIndex, string_view(value, length));
+				else
+				{
+					xmlChar *decoded = xmlStringLenDecodeEntities(_parserCtxt, attribute[3], length, XML_SUBSTITUTE_REF, 0, 0, 0);
+					assign(fieldIndex, decoded == nullptr ? ""sv : string_view(reinterpret_cast<const char *>(decoded)));
+					xmlFree(decoded);
+				}
+				break;
+			}
+		}
+	}
+
+	void stop(exception_ptr exception)
+	{
+		_exception = std::move(exception);
+		xmlStopParser(_parserCtxt);
+	}
+
+	static void startElement(
+		void *context, const xmlChar *localName, const xmlChar *prefix, const xmlChar *, int, const xmlChar **, const int attributesNumber, int,
+		const xmlChar **attributes
+	)
+	{
+		auto *parser = static_cast<BindingParser *>(context);
+		try
+		{
+			parser->_depth++;
+			if (parser->_skipDepth != 0)
+				return;
+
+			if (parser->_pathNodesStack.empty())
+			{
+				// the subtrees not matching the record path are skipped, so the ancestors of the element match it
+				const size_t step = parser->_depth - 1;
+				if (step >= parser->_recordPathSteps.size() || !nameMatches(parser->_recordPathSteps[step], localName, prefix))
+				{
+					parser->_skipDepth = parser->_depth;
+					return;
+				}
+				if (++parser->_matchedDepth < parser->_recordPathSteps.size())
+					return;
+
+				parser->_target.newRecord();
+				parser->_assigned.assign(parser->_assigned.size(), false);
+				parser->enter(0, attributesNumber, attributes);
+
+				return;
+			}
+
+			const PathNode &pathNode = parser->_pathNodes[parser->_pathNodesStack.back()];
+			auto child = ranges::find_if(pathNode.children, [&](const auto &child) { return nameMatches(child.first, localName, prefix); });
+			if (child == pathNode.children.end())
+				parser->_skipDepth = parser->_depth;
+			else
+				parser->enter(child->second, attributesNumber, attributes);
+		}
+		catch (...)
+		{
+			parser->stop(current_exception());
+		}
+	}
+
+	static void endElement(void *context, const xmlChar *, const xmlChar *, const xmlChar *)
+	{
+		auto *parser = static_cast<BindingParser *>(context);
+		try
+		{
+			if (parser->_skipDepth != 0)
+			{
+				if (parser->_depth == parser->_skipDepth)
+					parser->_skipDepth = 0;
+			}
+			else if (parser->_pathNodesStack.empty())
+				parser->_matchedDepth--;
+			else
+			{
+				for (const size_t fieldIndex : parser->_pathNodes[parser->_pathNodesStack.back()].textFields)
+					parser->assign(fieldIndex, parser->_texts[parser->_pathNodesStack.size() - 1]);
+				parser->_pathNodesStack.pop_back();
+				if (parser->_pathNodesStack.empty())
+				{
+					parser->_records++;
+					parser->_matchedDepth--;
+				}
+			}
+			parser->_depth--;
+		}
+		catch (...)
+		{
+			parser->stop(current_exception());
+		}
+	}
+
+	static void characters(void *context, const xmlChar *text, const int length)
+	{
+		auto *parser = static_cast<BindingParser *>(context);
+		if (parser->_skipDepth != 0 || parser->_pathNodesStack.empty() || parser->_pathNodes[parser->_pathNodesStack.back()].textFields.empty())
+			return;
+
+		try
+		{
+			parser->_texts[parser->_pathNodesStack.size() - 1].append(reinterpret_cast<const char *>(text), length);
+		}
+		catch (...)
+		{
+			parser->stop(current_exception());
+		}
+	}
+};
+
+// feed passes the input to the parser, return the number of records
+size_t parseBinding(
+	const XMLBindingTarget &target, const XMLParserOptions &parserOptions, const string &source, const function<void(ChunkParser &)> &feed
+)
+{
+	markLibxml2Used();
+	BindingParser bindingParser(target);
+	xmlSAXHandler sax = BindingParser::handler();
+	ChunkParser chunkParser(parserOptions.flags(), nullptr, nullptr, &sax, &bindingParser);
+	bindingParser.setParserContext(chunkParser.context());
+
+	feed(chunkParser);
+	const bool wellFormed = chunkParser.complete();
+	bindingParser.rethrow();
+	if (!wellFormed)
+	{
+		string errorMessage = std::format(
+			"xmlParseChunk failed"
+			", source: {}"
+			", records: {}",
+			source, bindingParser.records()
+		);
+		LOG_ERROR(errorMessage);
+
+		throw XMLReadMemory(errorMessage);
+	}
+	if (bindingParser.malformedValues() > 0)
+		LOG_ERROR(
+			"binding, malformed values left as initialized"
+			", source: {}"
+			", records: {}"
+			", malformedValues: {}",
+			source, bindingParser.records(), bindingParser.malformedValues()
+		);
+
+	return bindingParser.records();
+}
+
+using ValueError = XMLWrapper::ValueError;
+
+// the whitespaces around a value (i.e. indentation) are not part of it
+string_view trimSpaces(string_view text)
+{
+	constexpr string_view spaces = " \t\r\n";
+	const size_t first = text.find_first_not_of(spaces);
+	if (first == string_view::npos)
+		return {};
+
+	return text.substr(first, text.find_last_not_of(spaces) - first + 1);
+}
+
+bool isDigit(const char c) { return c >= '0' && c <= '9'; }
+
+// reads a number of exactly digits digits
+bool readNumber(string_view &text, const size_t digits, int &value)
+{
+	if (text.size() < digits || !all_of(text.begin(), text.begin() + static_cast<ptrdiff_t>(digits), isDigit))
+		return false;
+	from_chars(text.data(), text.data() + digits, value);
+	text.remove_prefix(digits);
+
+	return true;
+}
+
+bool readChar(string_view &text, const char c)
+{
+	if (!text.starts_with(c))
+		return false;
+	text.remove_prefix(1);
+
+	return true;
+}
+
+bool skipSpaces(string_view &text)
+{
+	const size_t spaces = min(text.find_first_not_of(" \t"), text.size());
+	text.remove_prefix(spaces);
+
+	return spaces > 0;
+}
+
+bool equalsIgnoreCase(const string_view text, const string_view other)
+{
+	return text.size() == other.size() && strncasecmp(text.data(), other.data(), text.size()) == 0;
+}
+
+ValueError parseText(string_view text, int64_t &value)
+{
+	text = trimSpaces(text);
+	// from_chars does not accept the plus sign
+	if (text.starts_with('+') && !text.substr(1).starts_with('-'))
+		text.remove_prefix(1);
+
+	auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+	if (error == errc::result_out_of_range)
+		return ValueError::OutOfRange;
+	if (error != errc() || end != text.data() + text.size())
+		return ValueError::Malformed;
+
+	return ValueError::None;
+}
+
+ValueError parseText(string_view text, double &value)
+{
+	text = trimSpaces(text);
+	if (text.starts_with('+') && !text.substr(1).starts_with('-'))
+		text.remove_prefix(1);
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+	auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+	if (error == errc::result_out_of_range)
+		return ValueError::OutOfRange;
+	if (error != errc() || end != text.data() + text.size())
+		return ValueError::Malformed;
+#else
+	// the floating point from_chars is not available in this standard library
+	const string copy(text);
+	char *end = nullptr;
+	errno = 0;
+	value = strtod(copy.c_str(), &end);
+	if (copy.empty() || end != copy.c_str() + copy.size())
+		return ValueError::Malformed;
+	if (errno == ERANGE)
+		return ValueError::OutOfRange;
+#endif
+
+	return ValueError::None;
+}
+
+ValueError parseText(string_view text, bool &value)
+{
+	// xs:boolean, the case of true/false is ignored
+	text = trimSpaces(text);
+	if (text == "1" || equalsIgnoreCase(text, "true"))
+		value = true;
+	else if (text == "0" || equalsIgnoreCase(text, "false"))
+		value = false;
+	else
+		return ValueError::Malformed;
+
+	return ValueError::None;
+}
+
+ValueError toTimePoint(
+	const int year, const int month, const int day, const int hour, const int minute, const int second, const chrono::nanoseconds fraction,
+	const chrono::minutes offset, XMLWrapper::TimePoint &value
+)
+{
+	const chrono::year_month_day date{chrono::year(year), chrono::month(static_cast<unsigned>(month)), chrono::day(static_cast<unsigned>(day))};
+	// 60 seconds is a leap second
+	if (!date.ok() || hour > 23 || minute > 59 || second > 60)
+		return ValueError::Malformed;
+
+	// i.e. 9999-12-31 does not fit a nanoseconds time point
+	const chrono::sys_seconds time = chrono::sys_days(date) + chrono::hours(hour) + chrono::minutes(minute) + chrono::seconds(second) - offset;
+	if (time <= chrono::time_point_cast<chrono::seconds>(XMLWrapper::TimePoint::min()) ||
+		time >= chrono::time_point_cast<chrono::seconds>(XMLWrapper::TimePoint::max()))
+		return ValueError::OutOfRange;
+	value = chrono::time_point_cast<XMLWrapper::TimePoint::duration>(time) + chrono::duration_cast<XMLWrapper::TimePoint::duration>(fraction);
+
+	return ValueError::None;
+}
+
+// YYYY-MM-DD[(T| )hh:mm[:ss[.fraction]]][Z|(+|-)hh[:]mm]
+ValueError parseISO8601(string_view text, XMLWrapper::TimePoint &value)
+{
+	int year;
+	int month;
+	int day;
+	int hour = 0;
+	int minute = 0;
+	int second = 0;
+	chrono::nanoseconds fraction(0);
+	chrono::minutes offset(0);
+
+	if (!readNumber(text, 4, year) || !readChar(text, '-') || !readNumber(text, 2, month) || !readChar(text, '-') || !readNumber(text, 2, day))
+		return ValueError::Malformed;
+	if (readChar(text, 'T') || readChar(text, ' '))
+	{
+		if (!readNumber(text, 2, hour) || !readChar(text, ':') || !readNumber(text, 2, minute))
+			return ValueError::Malformed;
+		if (readChar(text, ':'))
+		{
+			if (!readNumber(text, 2, second))
+				return ValueError::Malformed;
+			if (readChar(text, '.') || readChar(text, ','))
+			{
+				// digits after the ninth are ignored
+				size_t digits = 0;
+				int64_t nanoseconds = 0;
+				for (; digits < text.size() && isDigit(text[digits]); digits++)
+					if (digits < 9)
+						nanoseconds = nanoseconds * 10 + (text[digits] - '0');
+				if (digits == 0)
+					return ValueError::Malformed;
+				for (size_t scale = digits; scale < 9; scale++)
+					nanoseconds *= 10;
+				text.remove_prefix(digits);
+				fraction = chrono::nanoseconds(nanoseconds);
+			}
+		}
+	}
+	if (!readChar(text, 'Z') && (text.starts_with('+') || text.starts_with('-')))
+	{
+		const int sign = text[0] == '-' ? -1 : 1;
+		text.remove_prefix(1);
+		int offsetHours;
+		int offsetMinutes = 0;
+		if (!readNumber(text, 2, offsetHours))
+			return ValueError::Malformed;
+		readChar(text, ':');
+		if (!text.empty() && !readNumber(text, 2, offsetMinutes))
+			return ValueError::Malformed;
+		offset = sign * (chrono::hours(offsetHours) + chrono::minutes(offsetMinutes));
+	}
+	if (!text.empty())
+		return ValueError::Malformed;
+
+	return toTimePoint(year, month, day, hour, minute, second, fraction, offset, value);
+}
+
+// [Day, ]DD Mon YYYY hh:mm[:ss] [zone], i.e. Tue, 10 Jun 2003 04:00:00 GMT
+ValueError parseRFC822(string_view text, XMLWrapper::TimePoint &value)
+{
+	constexpr array<string_view, 12> monthNames = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+	constexpr array<pair<string_view, int>, 12> zones = {
+		{{"GMT", 0},
+		 {"UT", 0},
+		 {"UTC", 0},
+		 {"Z", 0},
+		 {"EST", -5 * 60},
+		 {"EDT", -4 * 60},
+		 {"CST", -6 * 60},
+		 {"CDT", -5 * 60},
+		 {"MST", -7 * 60},
+		 {"MDT", -6 * 60},
+		 {"PST", -8 * 60},
+		 {"PDT", -7 * 60}}
+	};
+
+	int year;
+	int month = 0;
+	int day;
+	int hour;
+	int minute;
+	int second = 0;
+	chrono::minutes offset(0);
+
+	if (const size_t comma = text.find(','); comma != string_view::npos)
+	{
+		text.remove_prefix(comma + 1);
+		skipSpaces(text);
+	}
+	if (!readNumber(text, text.size() > 1 && isDigit(text[1]) ? 2 : 1, day) || !skipSpaces(text) || text.size() < 3)
+		return ValueError::Malformed;
+	while (month < 12 && !equalsIgnoreCase(text.substr(0, 3), monthNames[month]))
+		month++;
+	if (month++ == 12)
+		return ValueError::Malformed;
+	text.remove_prefix(3);
+	if (!skipSpaces(text))
+		return ValueError::Malformed;
+	if (readNumber(text, 4, year))
+		;
+	else if (readNumber(text, 2, year))
+		year += year < 50 ? 2000 : 1900;
+	else
+		return ValueError::Malformed;
+	if (!skipSpaces(text) || !readNumber(text, 2, hour) || !readChar(text, ':') || !readNumber(text, 2, minute))
+		return ValueError::Malformed;
+	if (readChar(text, ':') && !readNumber(text, 2, second))
+		return ValueError::Malformed;
+	// a missing zone is taken as UTC
+	skipSpaces(text);
+	if (text.starts_with('+') || text.starts_with('-'))
+	{
+		const int sign = text[0] == '-' ? -1 : 1;
+		text.remove_prefix(1);
+		int offsetHours;
+		int offsetMinutes;
+		if (!readNumber(text, 2, offsetHours) || !readNumber(text, 2, offsetMinutes))
+			return ValueError::Malformed;
+		offset = sign * (chrono::hours(offsetHours) + chrono::minutes(offsetMinutes));
+	}
+	else if (!text.empty())
+	{
+		auto zone = find_if(zones.begin(), zones.end(), [text](const pair<string_view, int> &zone) { return equalsIgnoreCase(text, zone.first); });
+		if (zone == zones.end())
+			return ValueError::Malformed;
+		offset = chrono::minutes(zone->second);
+		text = {};
+	}
+	if (!text.empty())
+		return ValueError::Malformed;
+
+	return toTimePoint(year, month, day, hour, minute, second, chrono::nanoseconds(0), offset, value);
+}
+
+ValueError parseText(string_view text, XMLWrapper::TimePoint &value)
+{
+	text = trimSpaces(text);
+	if (text.size() >= 10 && isDigit(text[0]) && text[4] == '-')
+		return parseISO8601(text, value);
+
+	return parseRFC822(text, value);
+}
+
+// file of the XMLDocumentCache: the sections follow the header, every one 8 bytes aligned, with indexes and offsets instead of pointers:
+// url, eTag, lastModified, name offsets, names, namespaces, nodes (pre-order), attributes, texts.
+// Names and texts are NUL terminated so that they are passed to libxml2 straight from the mapping of the file
+constexpr array<char, 8> cacheMagic = {'X', 'M', 'L', 'W', 'D', 'C', '1', '\0'};
+constexpr uint32_t noIndex = numeric_limits<uint32_t>::max();
+// the xml prefix, predefined and never declared
+constexpr uint32_t xmlNamespaceIndex = noIndex - 1;
+constexpr uint64_t noText = numeric_limits<uint64_t>::max();
+// nesting allowed by libxml2 with XML_PARSE_HUGE, deeper documents are not cached and deeper images are rejected (the codec recurses)
+constexpr uint32_t maxCacheDepth = 2048;
+
+struct CacheHeader
+{
+	array<char, 8> magic;
+	uint32_t urlLength;
+	uint32_t eTagLength;
+	uint32_t lastModifiedLength;
+	uint32_t version;  // name index, noIndex if none
+	uint32_t encoding; // name index, noIndex if none
+	int32_t standalone;
+	uint32_t names;
+	uint32_t namespaces;
+	uint32_t nodes;
+	uint32_t attributes;
+	uint64_t namesBytes;
+	uint64_t textsBytes;
+};
+
+struct CachedNamespace
+{
+	uint32_t prefix; // noIndex for the default namespace
+	uint32_t href;
+};
+
+struct CachedNode
+{
+	uint32_t type;
+	uint32_t name; // noIndex for CDATA and comment, for a text the interned content if any
+	uint32_t ns;
+	uint32_t namespaces; // declared by the element, the next ones in the namespaces section
+	uint32_t attributes; // the next ones in the attributes section
+	uint32_t children;	 // the next subtrees in the nodes section
+	uint32_t contentLength;
+	uint32_t padding;
+	uint64_t content; // offset in the texts section, noText if none
+};
+
+struct CachedAttribute
+{
+	uint32_t name;
+	uint32_t ns;
+	uint64_t value; // noText if the value is interned
+	uint32_t valueLength;
+	uint32_t internedValue;
+};
+
+constexpr size_t cacheAligned(const size_t size) { return (size + 7) & ~size_t(7); }
+
+// the texts the SAX2 parser keeps in the dictionary: the indentation and the very short ones, most of the text nodes of a feed
+bool internedText(const xmlChar *content)
+{
+	const string_view view(reinterpret_cast<const char *>(content));
+	if (view.size() <= 3)
+		return true;
+
+	return view.size() < 60 && view.find_first_not_of(" \t\r\n") == string_view::npos;
+}
+
+class CacheEncoder
+{
+  public:
+	// false if the document cannot be cached: a DTD (entities, default attributes) or nodes other than elements, text, CDATA, comments and PIs, a nesting deeper than maxCacheDepth
+	bool encode(xmlDocPtr doc)
+	{
+		if (doc->intSubset != nullptr || doc->extSubset != nullptr)
+			return false;
+
+		_header.version = doc->version == nullptr ? noIndex : name(doc->version);
+		_header.encoding = doc->encoding == nullptr ? noIndex : name(doc->encoding);
+		_header.standalone = doc->standalone;
+		for (xmlNodePtr child = doc->children; child != nullptr; child = child->next)
+		{
+			if (!encodeNode(child, 1))
+				return false;
+		}
+
+		return true;
+	}
+
+	[[nodiscard]] string image(string_view url, string_view eTag, string_view lastModified)
+	{
+		_header.magic = cacheMagic;
+		_header.urlLength = static_cast<uint32_t>(url.size());
+		_header.eTagLength = static_cast<uint32_t>(eTag.size());
+		_header.lastModifiedLength = static_cast<uint32_t>(lastModified.size());
+		_header.names = static_cast<uint32_t>(_names.size());
+		_header.namespaces = static_cast<uint32_t>(_namespaces.size());
+		_header.nodes = static_cast<uint32_t>(_nodes.size());
+		_header.attributes = static_cast<uint32_t>(_attributes.size());
+		_header.textsBytes = _texts.size();
+
+		vector<uint32_t> nameOffsets;
+		nameOffsets.reserve(_names.size());
+		string names;
+		for (string_view name : _names)
+		{
+			nameOffsets.push_back(static_cast<uint32_t>(names.size()));
+			names.append(name);
+			names.push_back('\0');
+		}
+		_header.namesBytes = names.size();
+
+		string image;
+		append(image, string_view(reinterpret_cast<const char *>(&_header), sizeof(_header)));
+		append(image, string(url) + string(eTag) + string(lastModified));
+		append(image, string_view(reinterpret_cast<const char *>(nameOffsets.data()), nameOffsets.size() * sizeof(uint32_t)));
+		append(image, names);
+		append(image, string_view(reinterpret_cast<const char *>(_namespaces.data()), _namespaces.size() * sizeof(CachedNamespace)));
+		append(image, string_view(reinterpret_cast<const char *>(_nodes.data()), _nodes.size() * sizeof(CachedNode)));
+		append(image, string_view(reinterpret_cast<const char *>(_attributes.data()), _attributes.size() * sizeof(CachedAttribute)));
+		append(image, _texts);
+
+		return image;
+	}
+
+  private:
+	CacheHeader _header{};
+	unordered_map<string_view, uint32_t> _nameIndexes;
+	vector<string_view> _names;
+	unordered_map<xmlNsPtr, uint32_t> _namespaceIndexes;
+	vector<CachedNamespace> _namespaces;
+	vector<CachedNode> _nodes;
+	vector<CachedAttribute> _attributes;
+	string _texts;
+
+	static void append(string &image, string_view section)
+	{
+		image.append(section);
+		image.resize(cacheAligned(image.size()), '\0');
+	}
+
+	uint32_t name(const xmlChar *name)
+	{
+		const string_view view(reinterpret_cast<const char *>(name));
+		auto [it, inserted] = _nameIndexes.try_emplace(view, static_cast<uint32_t>(_names.size()));
+		if (inserted)
+			_names.push_back(view);
+
+		return it->second;
+	}
+
+	uint64_t text(const xmlChar *content, uint32_t &length)
+	{
+		if (content == nullptr)
+		{
+			length = 0;
+			return noText;
+		}
+
+		const uint64_t offset = _texts.size();
+		const string_view view(reinterpret_cast<const char *>(content));
+		length = static_cast<uint32_t>(view.size());
+		_texts.append(view);
+		_texts.push_back('\0');
+
+		return offset;
+	}
+
+	// the namespace of a node is declared by the node itself or by an ancestor, already encoded
+	bool namespaceIndex(xmlNsPtr ns, uint32_t &index) const
+	{
+		if (ns == nullptr)
+			index = noIndex;
+		else if (auto it = _namespaceIndexes.find(ns); it != _namespaceIndexes.end())
+			index = it->second;
+		else if (ns->prefix != nullptr && xmlStrEqual(ns->prefix, BAD_CAST "xml"))
+			index = xmlNamespaceIndex;
+		else
+			return false;
+
+		return true;
+	}
+
+	bool encodeNode(xmlNodePtr node, const uint32_t depth)
+	{
+		if (depth > maxCacheDepth)
+			return false;
+
+		CachedNode cachedNode{.type = static_cast<uint32_t>(node->type), .name = noIndex, .ns = noIndex, .content = noText};
+		switch (node->type)
+		{
+		case XML_ELEMENT_NODE:
+			cachedNode.name = name(node->name);
+			for (xmlNsPtr ns = node->nsDef; ns != nullptr; ns = ns->next)
+			{
+				_namespaceIndexes[ns] = static_cast<uint32_t>(_namespaces.size());
+				_namespaces.push_back({.prefix = ns->prefix == nullptr ? noIndex : name(ns->prefix), .href = name(ns->href)});
+				cachedNode.namespaces++;
+			}
+			if (!namespaceIndex(node->ns, cachedNode.ns))
+				return false;
+			for (xmlAttrPtr attribute = node->properties; attribute != nullptr; attribute = attribute->next)
+			{
+				// a value split in more nodes has entity references
+				if (attribute->children != nullptr && (attribute->children->type != XML_TEXT_NODE || attribute->children->next != nullptr))
+					return false;
+				CachedAttribute cachedAttribute{.name = name(attribute->name), .value = noText, .internedValue = noIndex};
+				if (!namespaceIndex(attribute->ns, cachedAttribute.ns))
+					return false;
+				const xmlChar *value = attribute->children == nullptr ? BAD_CAST "" : attribute->children->content;
+				if (internedText(value))
+					cachedAttribute.internedValue = name(value);
+				else
+					cachedAttribute.value = text(value, cachedAttribute.valueLength);
+				_attributes.push_back(cachedAttribute);
+				cachedNode.attributes++;
+			}
+			break;
+		case XML_PI_NODE:
+			cachedNode.name = name(node->name);
+			cachedNode.content = text(node->content, cachedNode.contentLength);
+			break;
+		case XML_TEXT_NODE:
+			if (node->content != nullptr && internedText(node->content))
+				cachedNode.name = name(node->content);
+			else
+				cachedNode.content = text(node->content, cachedNode.contentLength);
+			break;
+		case XML_CDATA_SECTION_NODE:
+		case XML_COMMENT_NODE:
+			cachedNode.content = text(node->content, cachedNode.contentLength);
+			break;
+		default:
+			return false;
+		}
+
+		// the number of children is known once they are encoded
+		const size_t nodeIndex = _nodes.size();
+		_nodes.push_back(cachedNode);
+		if (node->type == XML_ELEMENT_NODE)
+		{
+			for (xmlNodePtr child = node->children; child != nullptr; child = child->next)
+			{
+				if (!encodeNode(child, depth + 1))
+					return false;
+				_nodes[nodeIndex].children++;
+			}
+		}
+
+		return true;
+	}
+};
+
+// rebuilds the document reading the image in place, every index and offset is checked: a corrupted file is not read out of its bounds
+class CacheDecoder
+{
+  public:
+	explicit CacheDecoder(string_view image) : _image(image) {}
+
+	// the sections are located, false if the image is not a complete file of this format
+	bool open()
+	{
+		if (_image.size() < sizeof(CacheHeader))
+			return false;
+		memcpy(&_header, _image.data(), sizeof(_header));
+		if (_header.magic != cacheMagic)
+			return false;
+
+		size_t offset = cacheAligned(sizeof(CacheHeader));
+		if (!section(offset, static_cast<uint64_t>(_header.urlLength) + _header.eTagLength + _header.lastModifiedLength, _keys) ||
+			!section(offset, static_cast<uint64_t>(_header.names) * sizeof(uint32_t), _nameOffsets) || !section(offset, _header.namesBytes, _names) ||
+			!section(offset, static_cast<uint64_t>(_header.namespaces) * sizeof(CachedNamespace), _namespaces) ||
+			!section(offset, static_cast<uint64_t>(_header.nodes) * sizeof(CachedNode), _nodes) ||
+			!section(offset, static_cast<uint64_t>(_header.attributes) * sizeof(CachedAttribute), _attributes) ||
+			!section(offset, _header.textsBytes, _texts))
+			return false;
+
+		return offset == _image.size() && (_header.namesBytes == 0 || _image[_names + _header.namesBytes - 1] == '\0');
+	}
+
+	[[nodiscard]] string_view url() const { return _image.substr(_keys, _header.urlLength); }
+	[[nodiscard]] string_view eTag() const { return _image.substr(_keys + _header.urlLength, _header.eTagLength); }
+	[[nodiscard]] string_view lastModified() const { return _image.substr(_keys + _header.urlLength + _header.eTagLength, _header.lastModifiedLength); }
+
+	// dict is owned by the returned document (freed if nullptr is returned)
+	xmlDocPtr decode(xmlDictPtr dict)
+	{
+		if (dict == nullptr)
+			return nullptr;
+		xmlDocPtr doc = xmlNewDoc(nullptr);
+		if (doc == nullptr)
+		{
+			xmlDictFree(dict);
+			return nullptr;
+		}
+		doc->dict = dict;
+
+		bool decoded = decodeNames(dict) && (_header.version == noIndex || _header.version < _dictNames.size()) &&
+					   (_header.encoding == noIndex || _header.encoding < _dictNames.size());
+		if (decoded)
+		{
+			if (_header.version != noIndex)
+			{
+				xmlFree(const_cast<xmlChar *>(doc->version));
+				doc->version = xmlStrdup(_dictNames[_header.version]);
+			}
+			if (_header.encoding != noIndex)
+				doc->encoding = xmlStrdup(_dictNames[_header.encoding]);
+			doc->standalone = _header.standalone;
+		}
+		while (decoded && _nodeIndex < _header.nodes)
+			decoded = decodeNode(doc, reinterpret_cast<xmlNodePtr>(doc), 1);
+		if (!decoded || _attributeIndex != _header.attributes || _namespaceIndex != _header.namespaces)
+		{
+			xmlFreeDoc(doc);
+			return nullptr;
+		}
+
+		return doc;
+	}
+
+  private:
+	string_view _image;
+	CacheHeader _header{};
+	size_t _keys = 0;
+	size_t _nameOffsets = 0;
+	size_t _names = 0;
+	size_t _namespaces = 0;
+	size_t _nodes = 0;
+	size_t _attributes = 0;
+	size_t _texts = 0;
+	vector<const xmlChar *> _dictNames;
+	vector<xmlNsPtr> _decodedNamespaces;
+	uint32_t _nodeIndex = 0;
+	uint32_t _attributeIndex = 0;
+	uint32_t _namespaceIndex = 0;
+
+	// the section of bytes starts at offset, moved past it: false if the section does not fit in what remains of the image
+	bool section(size_t &offset, const uint64_t bytes, size_t &start) const
+	{
+		if (offset > _image.size() || bytes > _image.size() - offset)
+			return false;
+		start = offset;
+		offset = cacheAligned(offset + static_cast<size_t>(bytes));
+
+		return true;
+	}
+
+	template <typename T> T record(const size_t section, const uint32_t index) const
+	{
+		T value;
+		memcpy(&value, _image.data() + section + index * sizeof(T), sizeof(T));
+		return value;
+	}
+
+	// the names are interned once in the dictionary of the document, the elements then take them without any lookup
+	bool decodeNames(xmlDictPtr dict)
+	{
+		_dictNames.reserve(_header.names);
+		for (uint32_t nameIndex = 0; nameIndex < _header.names; nameIndex++)
+		{
+			const uint32_t offset = record<uint32_t>(_nameOffsets, nameIndex);
+			if (offset >= _header.namesBytes)
+				return false;
+			const xmlChar *name = xmlDictLookup(dict, BAD_CAST(_image.data() + _names + offset), -1);
+			if (name == nullptr)
+				return false;
+			_dictNames.push_back(name);
+		}
+
+		return true;
+	}
+
+	const xmlChar *text(const uint64_t offset, const uint32_t length) const
+	{
+		if (offset >= _header.textsBytes || offset + length >= _header.textsBytes || _image[_texts + offset + length] != '\0')
+			return nullptr;
+
+		return BAD_CAST(_image.data() + _texts + offset);
+	}
+
+	bool namespaceOf(xmlDocPtr doc, xmlNodePtr element, const uint32_t index, xmlNsPtr &ns) const
+	{
+		if (index == noIndex)
+			ns = nullptr;
+		else if (index == xmlNamespaceIndex)
+			ns = xmlSearchNs(doc, element, BAD_CAST "xml");
+		else if (index < _decodedNamespaces.size())
+			ns = _decodedNamespaces[index];
+		else
+			return false;
+
+		return index == noIndex || ns != nullptr;
+	}
+
+	static void appendChild(xmlNodePtr parent, xmlNodePtr child)
+	{
+		// linked directly, xmlAddChild would merge adjacent text nodes
+		child->parent = parent;
+		if (parent->last == nullptr)
+			parent->children = child;
+		else
+		{
+			parent->last->next = child;
+			child->prev = parent->last;
+		}
+		parent->last = child;
+	}
+
+	bool decodeNode(xmlDocPtr doc, xmlNodePtr parent, const uint32_t depth)
+	{
+		if (depth > maxCacheDepth || _nodeIndex >= _header.nodes)
+			return false;
+		const CachedNode cachedNode = record<CachedNode>(_nodes, _nodeIndex++);
+		if (cachedNode.name != noIndex && cachedNode.name >= _dictNames.size())
+			return false;
+
+		xmlNodePtr node = nullptr;
+		const xmlChar *content = cachedNode.content == noText ? nullptr : text(cachedNode.content, cachedNode.contentLength);
+		if (cachedNode.content != noText && content == nullptr)
+			return false;
+		switch (cachedNode.type)
+		{
+		case XML_ELEMENT_NODE:
+			if (cachedNode.name == noIndex)
+				return false;
+			// the name belongs to the dictionary of the document
+			node = xmlNewDocNodeEatName(doc, nullptr, const_cast<xmlChar *>(_dictNames[cachedNode.name]), nullptr);
+			break;
+		case XML_TEXT_NODE:
+			if (cachedNode.name == noIndex)
+				node = xmlNewDocTextLen(doc, content, static_cast<int>(cachedNode.contentLength));
+			else if ((node = xmlNewDocText(doc, nullptr)) != nullptr)
+				node->content = const_cast<xmlChar *>(_dictNames[cachedNode.name]); // freed by libxml2 only if not owned by the dictionary
+			break;
+		case XML_CDATA_SECTION_NODE:
+			node = xmlNewCDataBlock(doc, content, static_cast<int>(cachedNode.contentLength));
+			break;
+		case XML_COMMENT_NODE:
+			node = xmlNewDocComment(doc, content);
+			break;
+		case XML_PI_NODE:
+			if (cachedNode.name == noIndex)
+				return false;
+			node = xmlNewDocPI(doc, _dictNames[cachedNode.name], content);
+			break;
+		default:
+			return false;
+		}
+		if (node == nullptr)
+			return false;
+		appendChild(parent, node);
+		if (cachedNode.type != XML_ELEMENT_NODE)
+			return cachedNode.children == 0;
+
+		for (uint32_t namespaceIndex = 0; namespaceIndex < cachedNode.namespaces; namespaceIndex++)
+		{
+			if (_namespaceIndex >= _header.namespaces)
+				return false;
+			const CachedNamespace cachedNamespace = record<CachedNamespace>(_namespaces, _namespaceIndex++);
+			if (cachedNamespace.href >= _dictNames.size() || (cachedNamespace.prefix != noIndex && cachedNamespace.prefix >= _dictNames.size()))
+				return false;
+			xmlNsPtr ns =
+				xmlNewNs(node, _dictNames[cachedNamespace.href], cachedNamespace.prefix == noIndex ? nullptr : _dictNames[cachedNamespace.prefix]);
+			if (ns == nullptr)
+				return false;
+			_decodedNamespaces.push_back(ns);
+		}
+		if (!namespaceOf(doc, node, cachedNode.ns, node->ns))
+			return false;
+		for (uint32_t attributeIndex = 0; attributeIndex < cachedNode.attributes; attributeIndex++)
+		{
+			if (_attributeIndex >= _header.attributes)
+				return false;
+			const CachedAttribute cachedAttribute = record<CachedAttribute>(_attributes, _attributeIndex++);
+			const xmlChar *value;
+			if (cachedAttribute.internedValue == noIndex)
+				value = text(cachedAttribute.value, cachedAttribute.valueLength);
+			else
+				value = cachedAttribute.internedValue < _dictNames.size() ? _dictNames[cachedAttribute.internedValue] : nullptr;
+			xmlNsPtr ns;
+			if (cachedAttribute.name >= _dictNames.size() || value == nullptr || !namespaceOf(doc, node, cachedAttribute.ns, ns) ||
+				xmlNewNsProp(node, ns, _dictNames[cachedAttribute.name], value) == nullptr)
+				return false;
+		}
+		for (uint32_t childIndex = 0; childIndex < cachedNode.children; childIndex++)
+		{
+			if (!decodeNode(doc, node, depth + 1))
+				return false;
+		}
+
+		return true;
+	}
+};
+
+string cacheFileName(string_view url)
+{
+	// FNV-1a, stable across processes and builds
+	uint64_t hash = 0xcbf29ce484222325;
+	for (const char c : url)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 0x100000001b3;
+	}
+
+	return std::format("{:016x}.xmldoc", hash);
+}
+} // namespace
+
+int XMLParserOptions::flags() const
+{
+	int flags = otherOptions;
+	if (noBlanks)
+		flags |= XML_PARSE_NOBLANKS;
+	if (compact)
+		flags |= XML_PARSE_COMPACT;
+	if (noDict)
+		flags |= XML_PARSE_NODICT;
+	if (huge)
+		flags |= XML_PARSE_HUGE;
+	if (noNetwork)
+		flags |= XML_PARSE_NONET;
+	if (noCData)
+		flags |= XML_PARSE_NOCDATA;
+	if (substituteEntities)
+		flags |= XML_PARSE_NOENT;
+	if (recover)
+		flags |= XML_PARSE_RECOVER;
+
+	return flags;
+}
+
+XMLParserOptions XMLParserOptions::fastReadOnly()
+{
+	return {.noBlanks = true, .compact = true, .huge = true, .noNetwork = true, .noCData = true};
+}
+
+XMLParserPool::XMLParserPool(const size_t maxIdleContexts) : _maxIdleContexts(maxIdleContexts) { markLibxml2Used(); }
+
+XMLParserPool::~XMLParserPool()
+{
+	for (xmlParserCtxtPtr parserCtxt : _parserContexts)
+		xmlFreeParserCtxt(parserCtxt);
+	for (xmlXPathContextPtr xpathCtx : _xpathContexts)
+		xmlXPathFreeContext(xpathCtx);
+	// the documents still alive keep their own reference
+	if (_dict != nullptr)
+		xmlDictFree(_dict);
+}
+
+XMLParserPool::Stats XMLParserPool::stats() const
+{
+	lock_guard<mutex> locker(_mutex);
+
+	Stats stats = _stats;
+	stats.dictionaryNames = _dict != nullptr ? xmlDictSize(_dict) : 0;
+
+	return stats;
+}
+
+xmlDictPtr XMLParserPool::newDictionary() const
+{
+	lock_guard<mutex> locker(_mutex);
+
+	return _dict != nullptr ? xmlDictCreateSub(_dict) : xmlDictCreate();
+}
+
+void XMLParserPool::learnNames(xmlDocPtr doc)
+{
+	{
+		lock_guard<mutex> locker(_mutex);
+
+		if (_dict != nullptr)
+			return;
+	}
+
+	// the dictionary is filled out of the lock and published only when complete, from then on it is only read
+	xmlDictPtr dict = xmlDictCreate();
+	if (dict == nullptr)
+		return;
+	xmlDictLookup(dict, BAD_CAST "xml", 3);
+	xmlDictLookup(dict, BAD_CAST "xmlns", 5);
+	xmlDictLookup(dict, XML_XML_NAMESPACE, 36);
+	xmlNodePtr node = xmlDocGetRootElement(doc);
+	while (node != nullptr)
+	{
+		if (node->type == XML_ELEMENT_NODE)
+		{
+			xmlDictLookup(dict, node->name, -1);
+			for (xmlAttrPtr attribute = node->properties; attribute != nullptr; attribute = attribute->next)
+				xmlDictLookup(dict, attribute->name, -1);
+			for (xmlNsPtr ns = node->nsDef; ns != nullptr; ns = ns->next)
+				if (ns->prefix != nullptr)
+					xmlDictLookup(dict, ns->prefix, -1);
+		}
+
+		// depth-first walk, without recursion
+		if (node->type == XML_ELEMENT_NODE && node->children != nullptr)
+			node = node->children;
+		else
+		{
+			while (node != nullptr && node->next == nullptr)
+				node = node->parent != nullptr && node->parent->type == XML_ELEMENT_NODE ? node->parent : nullptr;
+			if (node != nullptr)
+				node = node->next;
+		}
+	}
+
+	lock_guard<mutex> locker(_mutex);
+
+	if (_dict == nullptr)
+		_dict = dict;
+	else
+		xmlDictFree(dict); // learned concurrently by another load
+}
+
+xmlParserCtxtPtr XMLParserPool::acquireParserContext()
+{
+	xmlParserCtxtPtr parserCtxt = nullptr;
+	{
+		lock_guard<mutex> locker(_mutex);
+
+		if (!_parserContexts.empty())
+		{
+			parserCtxt = _parserContexts.back();
+			_parserContexts.pop_back();
+			_stats.parserContextsReused++;
+		}
+		else
+			_stats.parserContextsCreated++;
+	}
+	if (parserCtxt == nullptr)
+	{
+		parserCtxt = xmlNewParserCtxt();
+		if (parserCtxt == nullptr)
+		{
+			string errorMessage = "xmlNewParserCtxt failed";
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+	}
+
+	xmlDictPtr dict = newDictionary();
+	if (dict == nullptr)
+	{
+		releaseParserContext(parserCtxt);
+
+		string errorMessage = "xmlDictCreate failed";
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+	setDictionary(parserCtxt, dict);
+
+	return parserCtxt;
+}
+
+void XMLParserPool::releaseParserContext(xmlParserCtxtPtr parserCtxt)
+{
+	// the dictionary stays alive as long as the document parsed with it
+	xmlCtxtReset(parserCtxt);
+	xmlDictFree(parserCtxt->dict);
+	parserCtxt->dict = nullptr;
+
+	{
+		lock_guard<mutex> locker(_mutex);
+
+		if (_parserContexts.size() < _maxIdleContexts)
+		{
+			_parserContexts.push_back(parserCtxt);
+
+			return;
+		}
+	}
+
+	xmlFreeParserCtxt(parserCtxt);
+}
+
+xmlXPathContextPtr XMLParserPool::acquireXPathContext(xmlDocPtr doc)
+{
+	xmlXPathContextPtr xpathCtx = nullptr;
+	{
+		lock_guard<mutex> locker(_mutex);
+
+		if (!_xpathContexts.empty())
+		{
+			xpathCtx = _xpathContexts.back();
+			_xpathContexts.pop_back();
+			_stats.xpathContextsReused++;
+		}
+		else
+			_stats.xpathContextsCreated++;
+	}
+	if (xpathCtx == nullptr)
+		return xmlXPathNewContext(doc);
+
+	xpathCtx->doc = doc;
+
+	return xpathCtx;
+}
+
+void XMLParserPool::releaseXPathContext(xmlXPathContextPtr xpathCtx)
+{
+	// the namespaces are registered again by the next document
+	xmlXPathRegisteredNsCleanup(xpathCtx);
+	xpathCtx->doc = nullptr;
+	xpathCtx->node = nullptr;
+
+	{
+		lock_guard<mutex> locker(_mutex);
+
+		if (_xpathContexts.size() < _maxIdleContexts)
+		{
+			_xpathContexts.push_back(xpathCtx);
+
+			return;
+		}
+	}
+
+	xmlXPathFreeContext(xpathCtx);
+}
+
+XMLDocumentCache::XMLDocumentCache(string directory) : _directory(std::move(directory))
+{
+	error_code errorCode;
+	filesystem::create_directories(_directory, errorCode);
+	if (errorCode)
+	{
+		string errorMessage = std::format(
+			"Creation of the cache directory failed"
+			", directory: {}"
+			", error: {}",
+			_directory, errorCode.message()
+		);
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+}
+
+string XMLDocumentCache::pathName(const string &url) const { return (filesystem::path(_directory) / cacheFileName(url)).string(); }
+
+bool XMLDocumentCache::store(const string &url, const XMLWrapper &xmlWrapper) const
+{
+	if (xmlWrapper._doc == nullptr)
+		return false;
+
+	string tmpPathName;
+	int fd = -1;
+	try
+	{
+		CacheEncoder encoder;
+		if (!encoder.encode(xmlWrapper._doc))
+			return false;
+		const string image = encoder.image(url, xmlWrapper._eTag, xmlWrapper._lastModified);
+
+		// written aside and renamed, a reader finds the previous file or the new one. Without fsync a crash may leave
+		// a truncated file, that load discards
+		const string cachePathName = pathName(url);
+		tmpPathName = cachePathName + ".XXXXXX";
+		fd = mkstemp(tmpPathName.data());
+		if (fd == -1)
+		{
+			string errorMessage = std::format(
+				"mkstemp failed"
+				", pathName: {}"
+				", errno: {}",
+				tmpPathName, errno
+			);
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+		writeAll(fd, image, tmpPathName);
+		int closeResult = close(fd);
+		fd = -1;
+		if (closeResult == -1 || rename(tmpPathName.c_str(), cachePathName.c_str()) == -1)
+		{
+			string errorMessage = std::format(
+				"close/rename failed"
+				", tmpPathName: {}"
+				", pathName: {}"
+				", errno: {}",
+				tmpPathName, cachePathName, errno
+			);
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+
+		return true;
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"XMLDocumentCache::store failed"
+			", url: {}"
+			", exception: {}",
+			url, e.what()
+		);
+
+		if (fd != -1)
+			close(fd);
+		if (!tmpPathName.empty())
+			unlink(tmpPathName.c_str());
+
+		return false;
+	}
+}
+
+void XMLDocumentCache::remove(const string &url) const { unlink(pathName(url).c_str()); }
+
+xmlDocPtr XMLDocumentCache::load(const string &url, string &eTag, string &lastModified, xmlDictPtr dict) const
+{
+	const string cachePathName = pathName(url);
+	int fd = open(cachePathName.c_str(), O_RDONLY | O_CLOEXEC);
+	struct stat fileStat{};
+	if (fd == -1 || fstat(fd, &fileStat) == -1 || fileStat.st_size == 0)
+	{
+		if (fd != -1)
+			close(fd);
+		if (dict != nullptr)
+			xmlDictFree(dict);
+
+		return nullptr;
+	}
+	const auto size = static_cast<size_t>(fileStat.st_size);
+	void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		LOG_ERROR(
+			"mmap failed"
+			", pathName: {}"
+			", errno: {}",
+			cachePathName, errno
+		);
+		if (dict != nullptr)
+			xmlDictFree(dict);
+
+		return nullptr;
+	}
+
+	xmlDocPtr doc = nullptr;
+	CacheDecoder decoder(string_view(static_cast<const char *>(mapping), size));
+	// a different url with the same file name is a miss
+	if (decoder.open() && decoder.url() == url)
+	{
+		eTag = decoder.eTag();
+		lastModified = decoder.lastModified();
+		doc = decoder.decode(dict);
+		if (doc == nullptr)
+			LOG_ERROR(
+				"The cached document is corrupted"
+				", url: {}"
+				", pathName: {}",
+				url, cachePathName
+			);
+	}
+	else if (dict != nullptr)
+		xmlDictFree(dict);
+	munmap(mapping, size);
+
+	return doc;
+}
+
+XMLWrapper::XPathResult::XPathResult(xmlXPathObjectPtr result) : _result(result) {}
+
+XMLWrapper::XPathResult::~XPathResult()
+{
+	if (_result != nullptr)
+		xmlXPathFreeObject(_result);
+}
+
+XMLWrapper::XPathResult::XPathResult(XPathResult &&other) noexcept : _result(exchange(other._result, nullptr)) {}
+
+XMLWrapper::XPathResult &XMLWrapper::XPathResult::operator=(XPathResult &&other) noexcept
+{
+	if (this != &other)
+	{
+		if (_result != nullptr)
+			xmlXPathFreeObject(_result);
+		_result = exchange(other._result, nullptr);
+	}
+
+	return *this;
+}
+
+size_t XMLWrapper::XPathResult::size() const
+{
+	return _result != nullptr && _result->nodesetval != nullptr ? static_cast<size_t>(_result->nodesetval->nodeNr) : 0;
+}
+
+xmlNodePtr *XMLWrapper::XPathResult::begin() const { return size() > 0 ? _result->nodesetval->nodeTab : nullptr; }
+
+xmlNodePtr *XMLWrapper::XPathResult::end() const { return size() > 0 ? _result->nodesetval->nodeTab + _result->nodesetval->nodeNr : nullptr; }
+
+xmlXPathObjectPtr XMLWrapper::XPathResult::release() { return exchange(_result, nullptr); }
+
+XMLWrapper::CompiledXPath::CompiledXPath(string expression, xmlXPathCompExprPtr compExpr)
+	: expression(std::move(expression)), compExpr(compExpr), simplePath(parseSimplePath(this->expression))
+{
+}
+
+XMLWrapper::CompiledXPath::~CompiledXPath()
+{
+	if (compExpr != nullptr)
+		xmlXPathFreeCompExpr(compExpr);
+}
+
+XMLFeedLoader::XMLFeedLoader(const size_t maxConnections, const size_t parseThreads, shared_ptr<XMLParserPool> parserPool)
+	: _maxConnections(max<size_t>(maxConnections, 1)), _parseThreads(parseThreads == 0 ? max(thread::hardware_concurrency(), 1u) : parseThreads),
+	  _parserPool(std::move(parserPool))
+{
+	// the libxml2 globals have to be initialized before parsing from more threads
+	markLibxml2Used();
+	xmlInitParser();
+}
+
+size_t XMLFeedLoader::load(const vector<Feed> &feeds, const function<void(FeedResult &&result)> &onLoaded) const
+{
+	struct Download
+	{
+		size_t feedIndex = 0;
+		string body;
+		string eTag;
+		string lastModified;
+	};
+
+	mutex queueMutex;
+	condition_variable queueChanged;
+	deque<Download> downloads;
+	const size_t queueCapacity = 2 * _parseThreads;
+	const size_t downloadThreads = min(_maxConnections, feeds.size());
+	size_t runningDownloadThreads = downloadThreads;
+	bool stopped = false;
+
+	atomic<size_t> nextFeed = 0;
+	mutex deliveryMutex;
+	exception_ptr exception;
+	size_t loaded = 0;
+
+	auto stop = [&](exception_ptr stopException)
+	{
+		{
+			lock_guard<mutex> locker(deliveryMutex);
+			if (!exception)
+				exception = std::move(stopException);
+		}
+		lock_guard<mutex> locker(queueMutex);
+		stopped = true;
+		queueChanged.notify_all();
+	};
+	auto deliver = [&](FeedResult &&result)
+	{
+		try
+		{
+			lock_guard<mutex> locker(deliveryMutex);
+			if (exception)
+				return;
+			if (result.error.empty())
+				loaded++;
+			onLoaded(std::move(result));
+		}
+		catch (...)
+		{
+			stop(current_exception());
+		}
+	};
+	auto failed = [&](const size_t feedIndex, const string &error)
+	{
+		LOG_ERROR(
+			"feed failed"
+			", url: {}"
+			", error: {}",
+			feeds[feedIndex].url, error
+		);
+		deliver(FeedResult{.feedIndex = feedIndex, .document = XMLWrapper(_parserPool), .error = error});
+	};
+
+	auto downloadFeeds = [&]()
+	{
+		for (size_t feedIndex = nextFeed++; feedIndex < feeds.size(); feedIndex = nextFeed++)
+		{
+			// once stopped (i.e. onLoaded threw) no other feed is downloaded, whatever the outcome of the previous one
+			{
+				lock_guard<mutex> locker(queueMutex);
+				if (stopped)
+					break;
+			}
+
+			const Feed &feed = feeds[feedIndex];
+			Download download;
+			download.feedIndex = feedIndex;
+			try
+			{
+				CurlWrapper::GetInputParameters inputParameters;
+				inputParameters.url = feed.url;
+				inputParameters.timeoutInSeconds = feed.timeoutInSeconds;
+				inputParameters.authorization = CurlWrapper::basicAuthorization(feed.basicAuthenticationUser, feed.basicAuthenticationPassword);
+				inputParameters.maxRetryNumber = feed.maxRetryNumber;
+				inputParameters.secondsToWaitBeforeToRetry = feed.secondsToWaitBeforeToRetry;
+				CurlWrapper::OutputParameters outputParameters;
+				{
+					MetricTimer timer(&MetricsRegistry::download);
+					download.body = CurlWrapper::httpGet(inputParameters, outputParameters);
+				}
+				countMetric(&MetricsRegistry::downloadedBytes, download.body.size());
+				download.eTag = outputParameters.getResponseHeaderValue("ETag");
+				download.lastModified = outputParameters.getResponseHeaderValue("Last-Modified");
+			}
+			catch (const std::exception &e)
+			{
+				failed(feedIndex, e.what());
+				continue;
+			}
+
+			unique_lock<mutex> locker(queueMutex);
+			queueChanged.wait(locker, [&]() { return downloads.size() < queueCapacity || stopped; });
+			if (stopped)
+				break;
+			downloads.push_back(std::move(download));
+			queueChanged.notify_all();
+		}
+	};
+	auto parseFeeds = [&]()
+	{
+		while (true)
+		{
+			Download download;
+			{
+				unique_lock<mutex> locker(queueMutex);
+				queueChanged.wait(locker, [&]() { return !downloads.empty() || runningDownloadThreads == 0 || stopped; });
+				if (stopped || downloads.empty())
+					break;
+				download = std::move(downloads.front());
+				downloads.pop_front();
+				queueChanged.notify_all();
+			}
+
+			const Feed &feed = feeds[download.feedIndex];
+			XMLWrapper document(_parserPool);
+			try
+			{
+				document.loadBody(
+					feed.url, std::move(download.body), download.eTag, download.lastModified, feed.nameServices, feed.sourceRetention, feed.parserOptions
+				);
+			}
+			catch (const std::exception &e)
+			{
+				failed(download.feedIndex, e.what());
+				continue;
+			}
+			deliver(FeedResult{.feedIndex = download.feedIndex, .document = std::move(document), .error = {}});
+		}
+	};
+
+	vector<thread> threads;
+	threads.reserve(downloadThreads + _parseThreads);
+	for (size_t threadIndex = 0; threadIndex < downloadThreads; threadIndex++)
+		threads.emplace_back(
+			[&]()
+			{
+				try
+				{
+					downloadFeeds();
+				}
+				catch (...)
+				{
+					stop(current_exception());
+				}
+				lock_guard<mutex> locker(queueMutex);
+				runningDownloadThreads--;
+				queueChanged.notify_all();
+			}
+		);
+	for (size_t threadIndex = 0; threadIndex < min(_parseThreads, feeds.size()); threadIndex++)
+		threads.emplace_back(
+			[&]()
+			{
+				try
+				{
+					parseFeeds();
+				}
+				catch (...)
+				{
+					stop(current_exception());
+				}
+			}
+		);
+	for (thread &thread : threads)
+		thread.join();
+
+	if (exception)
+		rethrow_exception(exception);
+
+	return loaded;
+}
+
+XMLWrapper::XMLWrapper()
+{
+	_doc = nullptr;
+	markLibxml2Used();
+}
+
+XMLWrapper::XMLWrapper(shared_ptr<XMLParserPool> parserPool) : _parserPool(std::move(parserPool))
+{
+	_doc = nullptr;
+	markLibxml2Used();
+}
+
+XMLWrapper::XMLWrapper(XMLWrapper &&other) noexcept
+	: _eTag(std::move(other._eTag)), _url(std::move(other._url)), _lastModified(std::move(other._lastModified)),
+	  _sourceXML(std::move(other._sourceXML)), _sourceMapping(exchange(other._sourceMapping, nullptr)),
+	  _sourceMappingSize(exchange(other._sourceMappingSize, 0)), _doc(exchange(other._doc, nullptr)),
+	  _xpathContexts(std::move(other._xpathContexts)), _nameServices(std::move(other._nameServices)),
+	  _parserPool(std::move(other._parserPool)), _arena(std::move(other._arena)), _documentCache(std::move(other._documentCache)),
+	  _attributeIndexes(std::move(other._attributeIndexes))
+{
+	other._xpathContexts.clear();
+	other._attributeIndexes.clear();
+}
+
+XMLWrapper &XMLWrapper::operator=(XMLWrapper &&other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	finish();
+	releaseSource();
+
+	_eTag = std::move(other._eTag);
+	_url = std::move(other._url);
+	_lastModified = std::move(other._lastModified);
+	_sourceXML = std::move(other._sourceXML);
+	_sourceMapping = exchange(other._sourceMapping, nullptr);
+	_sourceMappingSize = exchange(other._sourceMappingSize, 0);
+	_doc = exchange(other._doc, nullptr);
+	_xpathContexts = std::move(other._xpathContexts);
+	other._xpathContexts.clear();
+	_nameServices = std::move(other._nameServices);
+	_parserPool = std::move(other._parserPool);
+	// the XPath contexts and the document (if in arena mode) belong to the pool and to the arena of other
+	_arena = std::move(other._arena);
+	_documentCache = std::move(other._documentCache);
+	_attributeIndexes = std::move(other._attributeIndexes);
+	other._attributeIndexes.clear();
+
+	return *this;
+}
+
+XMLWrapper::~XMLWrapper()
+{
+	finish();
+	releaseSource();
+}
+
+void XMLWrapper::enableArenaAllocation()
+{
+	static once_flag hooksInstalled;
+
+	call_once(
+		hooksInstalled,
+		[]()
+		{
+			// a block allocated by libxml2 without the hooks would be freed by arenaFree as if it had the header
+			if (libxml2Used.load(memory_order_relaxed))
+			{
+				string errorMessage = "enableArenaAllocation failed, libxml2 was already used: it has to be called before any XMLWrapper, "
+									  "XMLParserPool or XMLFeedLoader is created";
+				LOG_ERROR(errorMessage);
+
+				throw runtime_error(errorMessage);
+			}
+			if (xmlMemSetup(arenaFree, arenaMalloc, arenaRealloc, arenaStrdup) != 0)
+			{
+				string errorMessage = "xmlMemSetup failed";
+				LOG_ERROR(errorMessage);
+
+				throw runtime_error(errorMessage);
+			}
+			// the globals of libxml2 are allocated now, out of any arena
+			xmlInitParser();
+			arenaHooksInstalled = true;
+		}
+	);
+}
+
+void XMLWrapper::setArenaAllocation(const bool arenaAllocation)
+{
+	if (arenaAllocation && !arenaHooksInstalled)
+	{
+		string errorMessage = "setArenaAllocation failed, enableArenaAllocation was not called";
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+
+	finish();
+	if (!arenaAllocation)
+		_arena.reset();
+	else if (_arena == nullptr)
+		_arena = make_unique<XMLDocumentArena>();
+}
+
+void XMLWrapper::setDocumentCache(shared_ptr<XMLDocumentCache> documentCache) { _documentCache = std::move(documentCache); }
+
+bool XMLWrapper::loadFromCache(const string &url, const vector<pair<string, string>> &nameServices)
+{
+	if (_documentCache == nullptr)
+		return false;
+
+	try
+	{
+		finish();
+		releaseSource();
+		_url.clear();
+		_eTag.clear();
+		_lastModified.clear();
+
+		string eTag;
+		string lastModified;
+		xmlDocPtr doc;
+		{
+			ArenaScope arenaScope(_arena.get());
+			xmlDictPtr dict = newDictionary();
+			doc = _documentCache->load(url, eTag, lastModified, dict != nullptr ? dict : xmlDictCreate());
+		}
+		if (doc == nullptr)
+			return false;
+
+		_url = url;
+		_eTag = std::move(eTag);
+		_lastModified = std::move(lastModified);
+		setDocument(doc, "XMLDocumentCache::load", url, nameServices);
+
+		return true;
+	}
+	catch (...)
+	{
+		finish();
+
+		throw;
+	}
+}
+
+void XMLWrapper::finish()
+{
+	{
+		lock_guard<mutex> locker(_xpathContextsMutex);
+
+		for (xmlXPathContextPtr xpathCtx : _xpathContexts)
+		{
+			if (_parserPool != nullptr)
+				_parserPool->releaseXPathContext(xpathCtx);
+			else
+				xmlXPathFreeContext(xpathCtx);
+		}
+		_xpathContexts.clear();
+	}
+	dropAttributeIndexes();
+	if (_doc != nullptr)
+	{
+		// a document in the arena is released as a whole, without walking the tree
+		if (_arena == nullptr)
+			xmlFreeDoc(_doc);
+		_doc = nullptr;
+	}
+	if (_arena != nullptr)
+		_arena->release();
+}
+
+void XMLWrapper::loadXML(
+	const string& url, int16_t timeoutInSeconds, const string& basicAuthenticationUser, const string& basicAuthenticationPassword,
+	int16_t maxRetryNumber, int16_t secondsToWaitBeforeToRetry, const vector<pair<string, string>>& nameServices,
+	const SourceRetention sourceRetention, const XMLParserOptions &parserOptions
+)
+{
+	try
+	{
+		// the cached document is validated by the server: on 304 it is kept and nothing is downloaded
+		if (_documentCache != nullptr && loadFromCache(url, nameServices) && (!_eTag.empty() || !_lastModified.empty()))
+		{
+			try
+			{
+				refresh(
+					url, timeoutInSeconds, basicAuthenticationUser, basicAuthenticationPassword, maxRetryNumber, secondsToWaitBeforeToRetry,
+					nameServices, sourceRetention, parserOptions
+				);
+			}
+			catch (const exception &e)
+			{
+				// the download failed: the cached document is still served. It is lost only if the new body was downloaded but not parsed
+				if (_doc == nullptr)
+					throw;
+
+				LOG_ERROR(
+					"loadXML, the cached document is kept"
+					", url: {}"
+					", exception: {}",
+					url, e.what()
+				);
+			}
+
+			return;
+		}
+
+		finish();
+		releaseSource();
+
+		CurlWrapper::GetInputParameters inputParameters {
+			.url = url,
+			.timeoutInSeconds = timeoutInSeconds,
+			.authorization = CurlWrapper::basicAuthorization(basicAuthenticationUser, basicAuthenticationPassword),
+			.maxRetryNumber = maxRetryNumber,
+			.secondsToWaitBeforeToRetry = secondsToWaitBeforeToRetry
+		};
+		CurlWrapper::OutputParameters outputParameters;
+		string body;
+		{
+			MetricTimer timer(&MetricsRegistry::download);
+			body = CurlWrapper::httpGet(inputParameters, outputParameters);
+		}
+		countMetric(&MetricsRegistry::downloadedBytes, body.size());
+
+		loadBody(
+			url, std::move(body), outputParameters.getResponseHeaderValue("ETag"), outputParameters.getResponseHeaderValue("Last-Modified"),
+			nameServices, sourceRetention, parserOptions
+		);
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"loadXML failed"
+			", url: {}"
+			", exception: {}",
+			url, e.what()
+		);
+
+		finish();
+
+		throw;
+	}
+}
+
+bool XMLWrapper::refresh(
+	const string &url, int16_t timeoutInSeconds, const string &basicAuthenticationUser, const string &basicAuthenticationPassword,
+	int16_t maxRetryNumber, int16_t secondsToWaitBeforeToRetry, const vector<pair<string, string>> &nameServices,
+	const SourceRetention sourceRetention, const XMLParserOptions &parserOptions
+)
+{
+	// without a document previously loaded from the same url there is nothing to validate
+	if (_doc == nullptr || url != _url || (_eTag.empty() && _lastModified.empty()))
+	{
+		loadXML(
+			url, timeoutInSeconds, basicAuthenticationUser, basicAuthenticationPassword, maxRetryNumber, secondsToWaitBeforeToRetry, nameServices,
+			sourceRetention, parserOptions
+		);
+
+		return true;
+	}
+
+	try
+	{
+		CurlWrapper::GetInputParameters inputParameters {
+			.url = url,
+			.timeoutInSeconds = timeoutInSeconds,
+			.authorization = CurlWrapper::basicAuthorization(basicAuthenticationUser, basicAuthenticationPassword),
+			.maxRetryNumber = maxRetryNumber,
+			.secondsToWaitBeforeToRetry = secondsToWaitBeforeToRetry
+		};
+		if (!_eTag.empty())
+			inputParameters.otherHeaders.push_back(std::format("If-None-Match: {}", _eTag));
+		if (!_lastModified.empty())
+			inputParameters.otherHeaders.push_back(std::format("If-Modified-Since: {}", _lastModified));
+		CurlWrapper::OutputParameters outputParameters;
+		string body;
+		{
+			MetricTimer timer(&MetricsRegistry::download);
+			body = CurlWrapper::httpGet(inputParameters, outputParameters);
+		}
+		countMetric(&MetricsRegistry::downloadedBytes, body.size());
+
+		// 304 Not Modified: the document, the XPath context and the source are kept as they are
+		if (outputParameters.responseCode == 304)
+			return false;
+
+		loadBody(
+			url, std::move(body), outputParameters.getResponseHeaderValue("ETag"), outputParameters.getResponseHeaderValue("Last-Modified"),
+			nameServices, sourceRetention, parserOptions
+		);
+
+		return true;
+	}
+	catch (const exception &e)
+	{
+		// if the download failed the current document is still valid and it is kept, loadBody frees it only if the new one cannot be parsed
+		LOG_ERROR(
+			"refresh failed"
+			", url: {}"
+			", exception: {}",
+			url, e.what()
+		);
+
+		throw;
+	}
+}
+
+void XMLWrapper::loadBody(
+	const string &url, string &&body, const string &eTag, const string &lastModified, const vector<pair<string, string>> &nameServices,
+	const SourceRetention sourceRetention, const XMLParserOptions &parserOptions
+)
+{
+	try
+	{
+		finish();
+		releaseSource();
+
+		_url = url;
+		_eTag = eTag;
+		_lastModified = lastModified;
+
+		/*
+		 * The document being in memory, it have no base per RFC 2396,
+		 * and the "noname.xml" argument will serve as its base.
+		 */
+		/*
+		This is an annoying failure of the libXml library. As noted by cateof, the problem is the default namespace declaration:
+		xmlns="http://www.example.com/new"
+		Two choices:
+		(1) get rid of that declaration in your book tag or (2) give it a name, and use that name in your tags.
+		*/
+		// xml = StringUtils::replaceAll(xml, "xmlns=", "xmlns:mio=");
+		// the body is parsed where it was downloaded, without intermediate copies.
+		// In case of Retain it is moved first, so that it is available through sourceXML() even if the parsing fails
+		if (sourceRetention == SourceRetention::Retain)
+		{
+			_sourceXML = std::move(body);
+			parseMemory(_sourceXML, url, nameServices, parserOptions);
+		}
+		else
+		{
+			parseMemory(body, url, nameServices, parserOptions);
+			if (sourceRetention == SourceRetention::MappedFile)
+				mapSource(body);
+		}
+		if (_documentCache != nullptr)
+			_documentCache->store(url, *this);
+		// doc = xmlParseFile("/var/log/cms/dump.xml");
+	}
+	catch (...)
+	{
+		finish();
+
+		throw;
+	}
+}
+
+void XMLWrapper::loadXMLIncremental(
+	const string &url, int16_t timeoutInSeconds, const string &basicAuthenticationUser, const string &basicAuthenticationPassword,
+	int16_t maxRetryNumber, int16_t secondsToWaitBeforeToRetry, const vector<pair<string, string>> &nameServices,
+	const XMLParserOptions &parserOptions
+)
+{
+	try
+	{
+		finish();
+		releaseSource();
+		_url.clear();
+		_eTag.clear();
+		_lastModified.clear();
+
+		for (int16_t retryNumber = 0;; retryNumber++)
+		{
+			try
+			{
+				downloadAndParse(url, timeoutInSeconds, basicAuthenticationUser, basicAuthenticationPassword, nameServices, parserOptions);
+
+				break;
+			}
+			catch (const XMLReadMemory &)
+			{
+				// a document not well formed does not change retrying
+				throw;
+			}
+			catch (const exception &e)
+			{
+				if (retryNumber >= maxRetryNumber)
+					throw;
+
+				LOG_ERROR(
+					"download failed, retrying"
+					", url: {}"
+					", retryNumber: {}"
+					", maxRetryNumber: {}"
+					", exception: {}",
+					url, retryNumber + 1, maxRetryNumber, e.what()
+				);
+				this_thread::sleep_for(chrono::seconds(secondsToWaitBeforeToRetry));
+			}
+		}
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"loadXMLIncremental failed"
+			", url: {}"
+			", exception: {}",
+			url, e.what()
+		);
+
+		finish();
+
+		throw;
+	}
+}
+
+void XMLWrapper::downloadAndParse(
+	const string &url, int16_t timeoutInSeconds, const string &basicAuthenticationUser, const string &basicAuthenticationPassword,
+	const vector<pair<string, string>> &nameServices, const XMLParserOptions &parserOptions
+)
+{
+	struct Transfer
+	{
+		CURL *curl = nullptr;
+		ChunkParser chunkParser;
+		long responseCode = 0;
+		bool parseFailed = false;
+		string eTag;
+		string lastModified;
+
+		Transfer(const int parserOptions, xmlDictPtr dict, XMLDocumentArena *arena) : chunkParser(parserOptions, dict, arena) {}
+		~Transfer()
+		{
+			if (curl != nullptr)
+				curl_easy_cleanup(curl);
+		}
+	} transfer(parserOptions.flags(), newDictionary(), _arena.get());
+
+	transfer.curl = curl_easy_init();
+	if (transfer.curl == nullptr)
+	{
+		string errorMessage = std::format(
+			"curl_easy_init failed"
+			", url: {}",
+			url
+		);
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+
+	curl_easy_setopt(transfer.curl, CURLOPT_URL, url.c_str());
+	curl_easy_setopt(transfer.curl, CURLOPT_TIMEOUT, static_cast<long>(timeoutInSeconds));
+	curl_easy_setopt(transfer.curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(transfer.curl, CURLOPT_FOLLOWLOCATION, 1L);
+	// any Content-Encoding supported by libcurl is accepted and decoded on the fly
+	curl_easy_setopt(transfer.curl, CURLOPT_ACCEPT_ENCODING, "");
+	if (!basicAuthenticationUser.empty())
+	{
+		curl_easy_setopt(transfer.curl, CURLOPT_HTTPAUTH, CURLAUTH_BASIC);
+		curl_easy_setopt(transfer.curl, CURLOPT_USERNAME, basicAuthenticationUser.c_str());
+		curl_easy_setopt(transfer.curl, CURLOPT_PASSWORD, basicAuthenticationPassword.c_str());
+	}
+	curl_easy_setopt(
+		transfer.curl, CURLOPT_HEADERFUNCTION,
+		+[](char *buffer, size_t size, size_t nitems, void *userdata) -> size_t
+		{
+			auto *transfer = static_cast<Transfer *>(userdata);
+			string_view header(buffer, size * nitems);
+			// a new status line (i.e. after a redirect) invalidates the headers received so far
+			if (header.starts_with("HTTP/"))
+			{
+				transfer->eTag.clear();
+				transfer->lastModified.clear();
+			}
+			else if (size_t colon = header.find(':'); colon != string_view::npos)
+			{
+				string_view name = header.substr(0, colon);
+				string_view value = header.substr(colon + 1);
+				while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+					value.remove_prefix(1);
+				while (!value.empty() && (value.back() == '\r' || value.back() == '\n' || value.back() == ' '))
+					value.remove_suffix(1);
+				if (name.size() == 4 && strncasecmp(name.data(), "ETag", 4) == 0)
+					transfer->eTag = value;
+				else if (name.size() == 13 && strncasecmp(name.data(), "Last-Modified", 13) == 0)
+					transfer->lastModified = value;
+			}
+
+			return size * nitems;
+		}
+	);
+	curl_easy_setopt(transfer.curl, CURLOPT_HEADERDATA, &transfer);
+	// every chunk is parsed as soon as it is received, the body is never buffered as a whole
+	curl_easy_setopt(
+		transfer.curl, CURLOPT_WRITEFUNCTION,
+		+[](char *buffer, size_t size, size_t nmemb, void *userdata) -> size_t
+		{
+			auto *transfer = static_cast<Transfer *>(userdata);
+			if (transfer->responseCode == 0)
+				curl_easy_getinfo(transfer->curl, CURLINFO_RESPONSE_CODE, &transfer->responseCode);
+			// returning less than received aborts the transfer
+			if (transfer->responseCode >= 400)
+				return 0;
+			countMetric(&MetricsRegistry::downloadedBytes, size * nmemb);
+			if (!transfer->chunkParser.parse(string_view(buffer, size * nmemb)))
+			{
+				transfer->parseFailed = true;
+				return 0;
+			}
+
+			return size * nmemb;
+		}
+	);
+	curl_easy_setopt(transfer.curl, CURLOPT_WRITEDATA, &transfer);
+
+	CURLcode curlCode;
+	{
+		MetricTimer timer(&MetricsRegistry::download);
+		curlCode = curl_easy_perform(transfer.curl);
+	}
+	if (transfer.responseCode == 0)
+		curl_easy_getinfo(transfer.curl, CURLINFO_RESPONSE_CODE, &transfer.responseCode);
+	if (!transfer.parseFailed && (curlCode != CURLE_OK || transfer.responseCode >= 400))
+	{
+		string errorMessage = std::format(
+			"download failed"
+			", url: {}"
+			", curlCode: {}"
+			", responseCode: {}",
+			url, curl_easy_strerror(curlCode), transfer.responseCode
+		);
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+
+	setDocument(transfer.parseFailed ? nullptr : transfer.chunkParser.finish(), "xmlParseChunk", url, nameServices);
+	_url = url;
+	_eTag = std::move(transfer.eTag);
+	_lastModified = std::move(transfer.lastModified);
+}
+
+void XMLWrapper::loadFromFile(const string &pathName, const vector<pair<string, string>> &nameServices, const XMLParserOptions &parserOptions)
+{
+	try
+	{
+		finish();
+		releaseSource();
+		_url.clear();
+		_eTag.clear();
+		_lastModified.clear();
+
+		MetricTimer timer(&MetricsRegistry::parse);
+		ifstream in(pathName, ios::binary);
+		char head[6];
+		in.read(head, sizeof(head));
+		const bool compressed = in.is_open() && detectCompression(string_view(head, in.gcount())) != Compression::None;
+		if (metricsEnabled.load(memory_order_relaxed))
+		{
+			error_code errorCode;
+			if (const uintmax_t fileSize = filesystem::file_size(pathName, errorCode); !errorCode)
+				countMetric(&MetricsRegistry::parsedBytes, fileSize);
+		}
+		if (!compressed && _parserPool != nullptr && _arena == nullptr)
+		{
+			xmlParserCtxtPtr parserCtxt = _parserPool->acquireParserContext();
+			xmlDocPtr doc = xmlCtxtReadFile(parserCtxt, pathName.c_str(), "UTF-8", parserOptions.flags());
+			_parserPool->releaseParserContext(parserCtxt);
+			setDocument(doc, "xmlCtxtReadFile", pathName, nameServices);
+		}
+		else if (!compressed)
+		{
+			xmlDocPtr doc;
+			{
+				ArenaScope arenaScope(_arena.get());
+				doc = xmlReadFile(pathName.c_str(), "UTF-8", parserOptions.flags());
+			}
+			setDocument(doc, "xmlReadFile", pathName, nameServices);
+		}
+		else
+		{
+			in.clear();
+			in.seekg(0);
+			ChunkParser chunkParser(parserOptions.flags(), newDictionary(), _arena.get());
+			vector<char> buffer(256 * 1024);
+			while (in.read(buffer.data(), static_cast<streamsize>(buffer.size())) || in.gcount() > 0)
+				if (!chunkParser.parse(string_view(buffer.data(), in.gcount())))
+					break;
+			setDocument(chunkParser.finish(), "xmlParseChunk", pathName, nameServices);
+		}
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"loadFromFile failed"
+			", pathName: {}"
+			", exception: {}",
+			pathName, e.what()
+		);
+
+		finish();
+
+		throw;
+	}
+}
+
+void XMLWrapper::loadFromMemory(string_view xml, const vector<pair<string, string>> &nameServices, const XMLParserOptions &parserOptions)
+{
+	try
+	{
+		finish();
+		releaseSource();
+		_url.clear();
+		_eTag.clear();
+		_lastModified.clear();
+
+		parseMemory(xml, "memory", nameServices, parserOptions);
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"loadFromMemory failed"
+			", size: {}"
+			", exception: {}",
+			xml.size(), e.what()
+		);
+
+		finish();
+
+		throw;
+	}
+}
+
+void XMLWrapper::loadFromFd(const int fd, const vector<pair<string, string>> &nameServices, const XMLParserOptions &parserOptions)
+{
+	try
+	{
+		finish();
+		releaseSource();
+		_url.clear();
+		_eTag.clear();
+		_lastModified.clear();
+
+		// the descriptor is read (and not closed) here so that a compressed input can be detected also on pipes
+		MetricTimer timer(&MetricsRegistry::parse);
+		ChunkParser chunkParser(parserOptions.flags(), newDictionary(), _arena.get());
+		vector<char> buffer(256 * 1024);
+		while (true)
+		{
+			ssize_t bytesRead = read(fd, buffer.data(), buffer.size());
+			if (bytesRead == -1 && errno == EINTR)
+				continue;
+			if (bytesRead == -1)
+			{
+				string errorMessage = std::format(
+					"read failed"
+					", fd: {}"
+					", errno: {}",
+					fd, errno
+				);
+				LOG_ERROR(errorMessage);
+
+				throw runtime_error(errorMessage);
+			}
+			if (bytesRead == 0)
+				break;
+			countMetric(&MetricsRegistry::parsedBytes, bytesRead);
+			if (!chunkParser.parse(string_view(buffer.data(), bytesRead)))
+				break;
+		}
+		setDocument(chunkParser.finish(), "xmlParseChunk", std::format("fd {}", fd), nameServices);
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"loadFromFd failed"
+			", fd: {}"
+			", exception: {}",
+			fd, e.what()
+		);
+
+		finish();
+
+		throw;
+	}
+}
+
+string_view XMLWrapper::sourceXML() const
+{
+	if (_sourceMapping != nullptr)
+		return {static_cast<const char *>(_sourceMapping), _sourceMappingSize};
+
+	return _sourceXML;
+}
+
+void XMLWrapper::mapSource(const string &body)
+{
+	if (body.empty())
+		return;
+
+	string pathName = (filesystem::temp_directory_path() / "XMLWrapper.XXXXXX").string();
+	int fd = mkstemp(pathName.data());
+	if (fd == -1)
+	{
+		string errorMessage = std::format(
+			"mkstemp failed"
+			", pathName: {}"
+			", errno: {}",
+			pathName, errno
+		);
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+	// the file stays alive (and can be evicted from memory by the kernel) until the mapping is released
+	unlink(pathName.c_str());
+
+	try
+	{
+		writeAll(fd, body, pathName);
+	}
+	catch (...)
+	{
+		close(fd);
+
+		throw;
+	}
+
+	void *mapping = mmap(nullptr, body.size(), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		string errorMessage = std::format(
+			"mmap failed"
+			", pathName: {}"
+			", errno: {}",
+			pathName, errno
+		);
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+
+	_sourceMapping = mapping;
+	_sourceMappingSize = body.size();
+}
+
+void XMLWrapper::releaseSource()
+{
+	_sourceXML.clear();
+	_sourceXML.shrink_to_fit();
+	if (_sourceMapping != nullptr)
+	{
+		munmap(_sourceMapping, _sourceMappingSize);
+		_sourceMapping = nullptr;
+		_sourceMappingSize = 0;
+	}
+}
+
+void XMLWrapper::parseMemory(
+	string_view xml, const string &source, const vector<pair<string, string>> &nameServices, const XMLParserOptions &parserOptions
+)
+{
+	MetricTimer timer(&MetricsRegistry::parse);
+	countMetric(&MetricsRegistry::parsedBytes, xml.size());
+
+	// a compressed payload is decompressed block by block directly into the push parser
+	if (detectCompression(xml) != Compression::None)
+	{
+		ChunkParser chunkParser(parserOptions.flags(), newDictionary(), _arena.get());
+		chunkParser.parse(xml);
+		setDocument(chunkParser.finish(), "xmlParseChunk", source, nameServices);
+
+		return;
+	}
+
+	if (_parserPool != nullptr && _arena == nullptr)
+	{
+		xmlParserCtxtPtr parserCtxt = _parserPool->acquireParserContext();
+		xmlDocPtr doc = xmlCtxtReadMemory(parserCtxt, xml.data(), static_cast<int>(xml.size()), "noname.xml", "UTF-8", parserOptions.flags());
+		_parserPool->releaseParserContext(parserCtxt);
+		setDocument(doc, "xmlCtxtReadMemory", source, nameServices);
+
+		return;
+	}
+
+	xmlDocPtr doc;
+	{
+		ArenaScope arenaScope(_arena.get());
+		doc = xmlReadMemory(xml.data(), static_cast<int>(xml.size()), "noname.xml", "UTF-8", parserOptions.flags());
+	}
+	setDocument(doc, "xmlReadMemory", source, nameServices);
+}
+
+void XMLWrapper::setDocument(xmlDocPtr doc, const string &readFunction, const string &source, const vector<pair<string, string>> &nameServices)
+{
+	if (doc == nullptr)
+	{
+		string errorMessage = std::format(
+			"The {} failed"
+			", source: {}",
+			readFunction, source
+		);
+		LOG_ERROR(errorMessage);
+
+		throw XMLReadMemory(errorMessage);
+	}
+
+	_doc = doc;
+	if (metricsEnabled.load(memory_order_relaxed))
+		countMetric(&MetricsRegistry::parsedNodes, countNodes(_doc));
+	if (_parserPool != nullptr)
+		_parserPool->learnNames(_doc);
+	createXPathContext(source, nameServices);
+}
+
+void XMLWrapper::createXPathContext(const string &source, const vector<pair<string, string>> &nameServices)
+{
+	_nameServices = nameServices;
+
+	// the first context is created now to report a failure at load time, the others are created on demand by acquireXPathContext
+	xmlXPathContextPtr xpathCtx = newXPathContext();
+	if (xpathCtx == nullptr)
+	{
+		string errorMessage = std::format(
+			"The xmlXPathNewContext failed"
+			", source: {}",
+			source
+		);
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+
+	releaseXPathContext(xpathCtx);
+}
+
+xmlXPathContextPtr XMLWrapper::newXPathContext() const
+{
+	/* Create xpath evaluation context */
+	xmlXPathContextPtr xpathCtx = _parserPool != nullptr ? _parserPool->acquireXPathContext(_doc) : xmlXPathNewContext(_doc);
+	if (xpathCtx == nullptr)
+		return nullptr;
+
+	xpathCtx->node = xmlDocGetRootElement(_doc); // context node = <entry>
+
+	for (const pair<string, string> &nameService : _nameServices)
+		xmlXPathRegisterNs(xpathCtx, BAD_CAST nameService.first.c_str(), BAD_CAST nameService.second.c_str());
+
+	return xpathCtx;
+}
+
+xmlDictPtr XMLWrapper::newDictionary() const
+{
+	return _parserPool != nullptr && _arena == nullptr ? _parserPool->newDictionary() : nullptr;
+}
+
+xmlXPathContextPtr XMLWrapper::acquireXPathContext() const
+{
+	{
+		lock_guard<mutex> locker(_xpathContextsMutex);
+
+		if (!_xpathContexts.empty())
+		{
+			xmlXPathContextPtr xpathCtx = _xpathContexts.back();
+			_xpathContexts.pop_back();
+
+			return xpathCtx;
+		}
+	}
+
+	// all the contexts are in use by other threads
+	return newXPathContext();
+}
+
+void XMLWrapper::releaseXPathContext(xmlXPathContextPtr xpathCtx) const
+{
+	lock_guard<mutex> locker(_xpathContextsMutex);
+
+	_xpathContexts.push_back(xpathCtx);
+}
+
+size_t XMLWrapper::streamFile(
+	const string &pathName, const string &recordPath, const vector<pair<string, string>> &nameServices, const function<void(XMLWrapper &record)> &onRecord,
+	const XMLParserOptions &parserOptions
+)
+{
+	markLibxml2Used();
+	try
+	{
+		ifstream in(pathName, ios::binary);
+		char head[6];
+		in.read(head, sizeof(head));
+		Compression compression = in.is_open() ? detectCompression(string_view(head, in.gcount())) : Compression::None;
+		in.clear();
+		in.seekg(0);
+
+		// a compressed file is decompressed block by block while the reader pulls its input
+		vector<char> buffer;
+		optional<DecompressingInput> decompressingInput;
+		xmlTextReaderPtr reader;
+		if (compression == Compression::None)
+			reader = xmlReaderForFile(pathName.c_str(), "UTF-8", parserOptions.flags());
+		else
+		{
+			buffer.resize(256 * 1024);
+			decompressingInput.emplace(
+				[&in, &buffer]() -> string_view
+				{
+					in.read(buffer.data(), static_cast<streamsize>(buffer.size()));
+					return {buffer.data(), static_cast<size_t>(in.gcount())};
+				},
+				compression
+			);
+			reader = xmlReaderForIO(DecompressingInput::read, nullptr, &*decompressingInput, "noname.xml", "UTF-8", parserOptions.flags());
+		}
+		if (reader == nullptr)
+		{
+			string errorMessage = std::format(
+				"xmlReaderForFile failed"
+				", pathName: {}",
+				pathName
+			);
+			LOG_ERROR(errorMessage);
+
+			throw XMLReadMemory(errorMessage);
+		}
+
+		return streamRecords(reader, pathName, recordPath, nameServices, onRecord);
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"streamFile failed"
+			", pathName: {}"
+			", recordPath: {}"
+			", exception: {}",
+			pathName, recordPath, e.what()
+		);
+
+		throw;
+	}
+}
+
+size_t XMLWrapper::streamMemory(
+	string_view xml, const string &recordPath, const vector<pair<string, string>> &nameServices, const function<void(XMLWrapper &record)> &onRecord,
+	const XMLParserOptions &parserOptions
+)
+{
+	markLibxml2Used();
+	try
+	{
+		optional<DecompressingInput> decompressingInput;
+		xmlTextReaderPtr reader;
+		if (Compression compression = detectCompression(xml); compression == Compression::None)
+			reader = xmlReaderForMemory(xml.data(), static_cast<int>(xml.size()), "noname.xml", "UTF-8", parserOptions.flags());
+		else
+		{
+			decompressingInput.emplace(
+				[xml]() mutable -> string_view
+				{
+					string_view chunk = xml;
+					xml = {};
+					return chunk;
+				},
+				compression
+			);
+			reader = xmlReaderForIO(DecompressingInput::read, nullptr, &*decompressingInput, "noname.xml", "UTF-8", parserOptions.flags());
+		}
+		if (reader == nullptr)
+		{
+			string errorMessage = std::format(
+				"xmlReaderForMemory failed"
+				", size: {}",
+				xml.size()
+			);
+			LOG_ERROR(errorMessage);
+
+			throw XMLReadMemory(errorMessage);
+		}
+
+		return streamRecords(reader, "memory", recordPath, nameServices, onRecord);
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"streamMemory failed"
+			", recordPath: {}"
+			", exception: {}",
+			recordPath, e.what()
+		);
+
+		throw;
+	}
+}
+
+size_t XMLWrapper::streamRecords(
+	xmlTextReaderPtr reader, const string &source, const string &recordPath, const vector<pair<string, string>> &nameServices,
+	const function<void(XMLWrapper &record)> &onRecord
+)
+{
+	struct ReaderGuard
+	{
+		xmlTextReaderPtr _reader;
+		~ReaderGuard() { xmlFreeTextReader(_reader); }
+	} guard{reader};
+
+	// i.e.: /feed/entry -> {"feed", "entry"}
+	vector<string> recordPathSteps;
+	for (size_t start = 0; start < recordPath.size();)
+	{
+		size_t end = recordPath.find('/', start);
+		if (end == string::npos)
+			end = recordPath.size();
+		if (end > start)
+			recordPathSteps.push_back(recordPath.substr(start, end - start));
+		start = end + 1;
+	}
+	if (recordPath.empty() || recordPath[0] != '/' || recordPathSteps.empty())
+	{
+		string errorMessage = std::format(
+			"recordPath has to be an absolute path of elements"
+			", recordPath: {}",
+			recordPath
+		);
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+
+	size_t records = 0;
+	int ret = xmlTextReaderRead(reader);
+	while (ret == 1)
+	{
+		if (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT)
+		{
+			ret = xmlTextReaderRead(reader);
+			continue;
+		}
+
+		// the subtrees of the elements not matching the path are skipped, so the ancestors of the current element always match
+		const size_t depth = xmlTextReaderDepth(reader);
+		const xmlChar *name = xmlTextReaderConstName(reader);
+		const xmlChar *localName = xmlTextReaderConstLocalName(reader);
+		if (depth >= recordPathSteps.size() ||
+			(!xmlStrEqual(name, BAD_CAST recordPathSteps[depth].c_str()) && !xmlStrEqual(localName, BAD_CAST recordPathSteps[depth].c_str())))
+		{
+			ret = xmlTextReaderNext(reader);
+			continue;
+		}
+		if (depth + 1 < recordPathSteps.size())
+		{
+			ret = xmlTextReaderRead(reader);
+			continue;
+		}
+
+		// the expanded subtree is valid until the reader moves on, it is copied in a small document owned by the record
+		xmlNodePtr recordNode = xmlTextReaderExpand(reader);
+		if (recordNode == nullptr)
+		{
+			ret = -1;
+			break;
+		}
+
+		XMLWrapper record;
+		record._doc = xmlNewDoc(BAD_CAST "1.0");
+		if (record._doc == nullptr)
+			throw bad_alloc();
+		xmlNodePtr recordRoot = xmlDocCopyNode(recordNode, record._doc, 1);
+		if (recordRoot == nullptr)
+			throw bad_alloc();
+		xmlDocSetRootElement(record._doc, recordRoot);
+		record.createXPathContext(source, nameServices);
+
+		onRecord(record);
+		records++;
+
+		ret = xmlTextReaderNext(reader);
+	}
+	if (ret < 0)
+	{
+		string errorMessage = std::format(
+			"xmlTextReader failed"
+			", source: {}"
+			", records: {}",
+			source, records
+		);
+		LOG_ERROR(errorMessage);
+
+		throw XMLReadMemory(errorMessage);
+	}
+
+	return records;
+}
+
+string XMLWrapper::asString(const bool pretty) const
+{
+	xmlChar* mem = nullptr;
+	try
+	{
+		if (!_doc)
+		{
+			const string errorMessage = "Document not initialized";
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+
+		/*
+		// Assicura versione/encoding (così libxml2 emette la declaration)
+		if (!_doc->version)
+			_doc->version = xmlStrdup(BAD_CAST "1.0");
+
+		// Imposta l'encoding: xmlCharEncodingHandler viene scelto dal nome ("UTF-8")
+		// Nota: doc->encoding è xmlChar*, va allocata con funzioni libxml2.
+		if (!_doc->encoding)
+			_doc->encoding = xmlStrdup(BAD_CAST "UTF-8");
+		*/
+
+		int size = 0;
+		{
+			MetricTimer timer(&MetricsRegistry::serialization);
+			if (pretty)
+				xmlDocDumpFormatMemoryEnc(_doc, &mem, &size, "UTF-8", 1);
+			else
+				xmlDocDumpMemoryEnc(_doc, &mem, &size, "UTF-8");
+		}
+		if (!mem || size <= 0)
+		{
+			const string errorMessage = std::format(
+				"xmlDocDumpMemoryEnc failed"
+				", size: {}", size
+				);
+			LOG_ERROR(errorMessage);
+
+			if (mem)
+				xmlFree(mem);
+
+			throw runtime_error(errorMessage);
+		}
+
+		countMetric(&MetricsRegistry::serializedBytes, size);
+		std::string sXML(reinterpret_cast<char*>(mem), static_cast<size_t>(size));
+		xmlFree(mem);
+
+		// vedi commento nel metodo loadXML
+		// sXML = StringUtils::replaceAll(sXML, "xmlns:mio=", "xmlns=");
+
+		return sXML;
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"asString failed"
+			", exception: {}",
+			e.what()
+		);
+
+		if (mem)
+			xmlFree(mem);
+
+		throw;
+	}
+}
+
+void XMLWrapper::saveXMLFile(string pathName, bool pretty, bool atomic, Compression compression) const
+{
+	int fd = -1;
+	string tmpPathName;
+	try
+	{
+		if (atomic)
+		{
+			// the temporary file is in the same directory, so that rename does not cross file systems
+			tmpPathName = pathName + ".XXXXXX";
+			fd = mkstemp(tmpPathName.data());
+			if (fd != -1)
+				fchmod(fd, 0644);
+		}
+		else
+			fd = open(pathName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd == -1)
+		{
+			const string errorMessage = std::format("Creation of file failed"
+				", pathName: {}"
+				", errno: {}", atomic ? tmpPathName : pathName, errno
+				);
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+
+		if (compression == Compression::None)
+			writeTo(fd, pretty);
+		else
+		{
+			// the serialized blocks are compressed and written as they are produced
+			Compressor compressor(compression);
+			const string &writtenPathName = atomic ? tmpPathName : pathName;
+			auto output = [fd, &writtenPathName](string_view data) { writeAll(fd, data, writtenPathName); };
+			writeTo([&compressor, &output](string_view chunk) { compressor.compress(chunk, output); }, pretty);
+			compressor.finish(output);
+		}
+
+		if (atomic && fsync(fd) == -1)
+		{
+			const string errorMessage = std::format("fsync failed"
+				", pathName: {}"
+				", errno: {}", tmpPathName, errno
+				);
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+		int closeResult = close(fd);
+		fd = -1;
+		if (closeResult == -1)
+		{
+			const string errorMessage = std::format("close failed"
+				", pathName: {}"
+				", errno: {}", atomic ? tmpPathName : pathName, errno
+				);
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+
+		if (atomic && rename(tmpPathName.c_str(), pathName.c_str()) == -1)
+		{
+			const string errorMessage = std::format("rename failed"
+				", tmpPathName: {}"
+				", pathName: {}"
+				", errno: {}", tmpPathName, pathName, errno
+				);
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"saveXML failed"
+			", pathName: {}"
+			", exception: {}",
+			pathName, e.what()
+		);
+
+		if (fd != -1)
+			close(fd);
+		if (atomic && !tmpPathName.empty())
+			unlink(tmpPathName.c_str());
+
+		throw;
+	}
+}
+
+void XMLWrapper::writeTo(const int fd, const bool pretty) const
+{
+	try
+	{
+		if (!_doc)
+		{
+			const string errorMessage = "Document not initialized";
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+
+		// the descriptor is not closed by xmlSaveClose
+		xmlSaveCtxtPtr saveCtxt = xmlSaveToFd(fd, "UTF-8", pretty ? XML_SAVE_FORMAT : 0);
+		save(saveCtxt, std::format("fd {}", fd));
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"writeTo failed"
+			", fd: {}"
+			", exception: {}",
+			fd, e.what()
+		);
+
+		throw;
+	}
+}
+
+void XMLWrapper::writeTo(const function<void(string_view chunk)> &write, const bool pretty) const
+{
+	try
+	{
+		if (!_doc)
+		{
+			const string errorMessage = "Document not initialized";
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+
+		// an exception cannot cross libxml2, it is kept here and rethrown once the save context is closed
+		struct Writer
+		{
+			const function<void(string_view chunk)> &write;
+			exception_ptr exception;
+		} writer{write, nullptr};
+		xmlSaveCtxtPtr saveCtxt = xmlSaveToIO(
+			[](void *context, const char *buffer, int len) -> int
+			{
+				auto *writer = static_cast<Writer *>(context);
+				try
+				{
+					writer->write(string_view(buffer, len));
+
+					return len;
+				}
+				catch (...)
+				{
+					writer->exception = current_exception();
+
+					return -1;
+				}
+			},
+			nullptr, &writer, "UTF-8", pretty ? XML_SAVE_FORMAT : 0
+		);
+		try
+		{
+			save(saveCtxt, "callback");
+		}
+		catch (...)
+		{
+			if (writer.exception)
+				rethrow_exception(writer.exception);
+
+			throw;
+		}
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"writeTo failed"
+			", exception: {}",
+			e.what()
+		);
+
+		throw;
+	}
+}
+
+void XMLWrapper::save(xmlSaveCtxtPtr saveCtxt, const string &destination) const
+{
+	if (saveCtxt == nullptr)
+	{
+		const string errorMessage = std::format("xmlSaveToFd/xmlSaveToIO failed"
+			", destination: {}", destination
+			);
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+
+	// the document is serialized through the small buffer of the save context, flushed by xmlSaveClose
+	MetricTimer timer(&MetricsRegistry::serialization);
+	long saveResult = xmlSaveDoc(saveCtxt, _doc);
+	int closeResult = xmlSaveClose(saveCtxt);
+	if (saveResult < 0 || closeResult < 0)
+	{
+		const string errorMessage = std::format("xmlSaveDoc failed"
+			", destination: {}"
+			", saveResult: {}"
+			", closeResult: {}", destination, saveResult, closeResult
+			);
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+	// bytes written
+	countMetric(&MetricsRegistry::serializedBytes, closeResult);
+}
+
+xmlNodePtr XMLWrapper::asRootNode() const
+{
+	try
+	{
+		if (_doc == nullptr)
+		{
+			string errorMessage = std::format("Document not initialized");
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+
+		return xmlDocGetRootElement(_doc);
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"asRootNode failed"
+			", exception: {}",
+			e.what()
+		);
+
+		throw;
+	}
+}
+
+XMLWrapper::PreparedXPath XMLWrapper::compiledXPath(const string &xPathExpression) { return xPathCache().get(xPathExpression); }
+
+XMLWrapper::PreparedXPath XMLWrapper::prepareXPath(const string &xPathExpression)
+{
+	markLibxml2Used();
+	PreparedXPath preparedXPath = compiledXPath(xPathExpression);
+	if (preparedXPath == nullptr)
+	{
+		string errorMessage = std::format(
+			"xmlXPathCompile failed"
+			", xPathExpression: {}",
+			xPathExpression
+		);
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+
+	return preparedXPath;
+}
+
+XMLWrapper::XPathCacheStats XMLWrapper::xPathCacheStats() { return xPathCache().stats(); }
+
+void XMLWrapper::setXPathCacheCapacity(const size_t capacity) { xPathCache().setCapacity(capacity); }
+
+void XMLWrapper::clearXPathCache() { xPathCache().clear(); }
+
+void XMLWrapper::enableMetrics(const bool enabled) { metricsEnabled = enabled; }
+
+XMLWrapper::Metrics XMLWrapper::metrics()
+{
+	const MetricsRegistry &registry = metricsRegistry();
+
+	Metrics metrics;
+	metrics.download = registry.download.snapshot();
+	metrics.parse = registry.parse.snapshot();
+	metrics.xPath = registry.xPath.snapshot();
+	metrics.serialization = registry.serialization.snapshot();
+	metrics.downloadedBytes = registry.downloadedBytes.load(memory_order_relaxed);
+	metrics.parsedBytes = registry.parsedBytes.load(memory_order_relaxed);
+	metrics.parsedNodes = registry.parsedNodes.load(memory_order_relaxed);
+	metrics.serializedBytes = registry.serializedBytes.load(memory_order_relaxed);
+	metrics.xPathMisses = registry.xPathMisses.load(memory_order_relaxed);
+	metrics.selectedNodes = registry.selectedNodes.load(memory_order_relaxed);
+	for (const PreparedXPath &preparedXPath : xPathCache().entries())
+	{
+		if (const uint64_t evaluations = preparedXPath->evaluations.load(memory_order_relaxed); evaluations > 0)
+			metrics.expressions.push_back(XPathExpressionMetrics{
+				.expression = preparedXPath->expression,
+				.evaluations = evaluations,
+				.misses = preparedXPath->misses.load(memory_order_relaxed),
+				.seconds = static_cast<double>(preparedXPath->nanoseconds.load(memory_order_relaxed)) / 1e9
+			});
+	}
+
+	return metrics;
+}
+
+string XMLWrapper::metricsText()
+{
+	const Metrics snapshot = metrics();
+
+	string text;
+	appendHistogram(text, "xmlwrapper_download_seconds", "Duration of the downloads", snapshot.download);
+	appendHistogram(text, "xmlwrapper_parse_seconds", "Duration of the parsing of the loaded documents", snapshot.parse);
+	appendHistogram(text, "xmlwrapper_xpath_seconds", "Duration of the XPath evaluations", snapshot.xPath);
+	appendHistogram(text, "xmlwrapper_serialization_seconds", "Duration of the serializations", snapshot.serialization);
+	appendCounter(text, "xmlwrapper_downloaded_bytes_total", "Bytes downloaded", snapshot.downloadedBytes);
+	appendCounter(text, "xmlwrapper_parsed_bytes_total", "Bytes parsed", snapshot.parsedBytes);
+	appendCounter(text, "xmlwrapper_parsed_nodes_total", "Nodes of the loaded documents", snapshot.parsedNodes);
+	appendCounter(text, "xmlwrapper_serialized_bytes_total", "Bytes serialized", snapshot.serializedBytes);
+	appendCounter(text, "xmlwrapper_xpath_misses_total", "XPath evaluations selecting no node", snapshot.xPathMisses);
+	appendCounter(text, "xmlwrapper_xpath_selected_nodes_total", "Nodes selected by the XPath evaluations", snapshot.selectedNodes);
+
+	if (!snapshot.expressions.empty())
+	{
+		text += "# HELP xmlwrapper_xpath_expression_evaluations_total Evaluations of the expression\n"
+				"# TYPE xmlwrapper_xpath_expression_evaluations_total counter\n";
+		for (const XPathExpressionMetrics &expression : snapshot.expressions)
+			text += std::format(
+				"xmlwrapper_xpath_expression_evaluations_total{{expression=\"{}\"}} {}\n", escapeLabel(expression.expression), expression.evaluations
+			);
+		text += "# HELP xmlwrapper_xpath_expression_misses_total Evaluations of the expression selecting no node\n"
+				"# TYPE xmlwrapper_xpath_expression_misses_total counter\n";
+		for (const XPathExpressionMetrics &expression : snapshot.expressions)
+			text += std::format("xmlwrapper_xpath_expression_misses_total{{expression=\"{}\"}} {}\n", escapeLabel(expression.expression), expression.misses);
+		text += "# HELP xmlwrapper_xpath_expression_seconds_total Time spent evaluating the expression\n"
+				"# TYPE xmlwrapper_xpath_expression_seconds_total counter\n";
+		for (const XPathExpressionMetrics &expression : snapshot.expressions)
+			text += std::format("xmlwrapper_xpath_expression_seconds_total{{expression=\"{}\"}} {}\n", escapeLabel(expression.expression), expression.seconds);
+	}
+
+	return text;
+}
+
+void XMLWrapper::resetMetrics()
+{
+	MetricsRegistry &registry = metricsRegistry();
+	registry.download.reset();
+	registry.parse.reset();
+	registry.xPath.reset();
+	registry.serialization.reset();
+	registry.downloadedBytes = 0;
+	registry.parsedBytes = 0;
+	registry.parsedNodes = 0;
+	registry.serializedBytes = 0;
+	registry.xPathMisses = 0;
+	registry.selectedNodes = 0;
+	for (const PreparedXPath &preparedXPath : xPathCache().entries())
+	{
+		preparedXPath->evaluations = 0;
+		preparedXPath->misses = 0;
+		preparedXPath->nanoseconds = 0;
+	}
+}
+
+xmlXPathObjectPtr XMLWrapper::xPath(const string& xPathExpression, xmlNodePtr startingNode, bool noErrorLog) const
+{
+	try
+	{
+		PreparedXPath preparedXPath = compiledXPath(xPathExpression);
+		if (preparedXPath == nullptr)
+		{
+			string errorMessage = std::format(
+				"xmlXPathCompile failed"
+				", xPathExpression: {}",
+				xPathExpression
+			);
+			if (!noErrorLog)
+				LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+
+		return xPath(preparedXPath, startingNode, noErrorLog);
+	}
+	catch (const exception &e)
+	{
+		if (!noErrorLog)
+			LOG_ERROR(
+				"xPath failed"
+				", xPathExpression: {}"
+				", exception: {}",
+				xPathExpression, e.what()
+			);
+
+		throw;
+	}
+}
+
+XMLWrapper::XPathResult XMLWrapper::select(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	PreparedXPath preparedXPath = compiledXPath(xPathExpression);
+	if (preparedXPath == nullptr)
+	{
+		string errorMessage = std::format(
+			"xmlXPathCompile failed"
+			", xPathExpression: {}",
+			xPathExpression
+		);
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+
+	return select(preparedXPath, startingNode);
+}
+
+XMLWrapper::XPathResult XMLWrapper::select(const PreparedXPath &preparedXPath, xmlNodePtr startingNode) const
+{
+	if (_doc == nullptr)
+	{
+		string errorMessage = std::format(
+			"select failed, document not initialized"
+			", xPathExpression: {}",
+			preparedXPath->expression
+		);
+		LOG_ERROR(errorMessage);
+
+		throw runtime_error(errorMessage);
+	}
+
+	// no match is an empty result, not an error
+	return XPathResult(evalXPath(*preparedXPath, startingNode));
+}
+
+xmlXPathObjectPtr XMLWrapper::evalXPath(const CompiledXPath &compiledXPath, xmlNodePtr startingNode) const
+{
+	// miss path: no exception and no message formatting, only the (empty) result object is freed
+	if (_doc == nullptr)
+		return nullptr;
+
+	const bool measured = metricsEnabled.load(memory_order_relaxed);
+	chrono::steady_clock::time_point start;
+	if (measured)
+		start = chrono::steady_clock::now();
+
+	xmlXPathObjectPtr resultToBeFreed = nullptr;
+	if (compiledXPath.simplePath != nullptr)
+	{
+		// the node set is filled walking the tree, the nodes come in document order and without duplicates
+		xmlNodeSetPtr nodeSet = nullptr;
+		auto addNode = [&nodeSet](xmlNodePtr node)
+		{
+			if (nodeSet == nullptr)
+				return (nodeSet = xmlXPathNodeSetCreate(node)) != nullptr;
+
+			return xmlXPathNodeSetAddUnique(nodeSet, node) == 0;
+		};
+		if (xmlNodePtr contextNode = simplePathContext(*compiledXPath.simplePath, _doc, startingNode); contextNode != nullptr)
+			walkSimplePath(*compiledXPath.simplePath, 0, contextNode, _nameServices, addNode);
+		if (nodeSet != nullptr && (resultToBeFreed = xmlXPathWrapNodeSet(nodeSet)) == nullptr)
+			xmlXPathFreeNodeSet(nodeSet);
+	}
+	else
+	{
+		// every evaluation uses its own context, so the context node set here is not seen by other threads
+		xmlXPathContextPtr xpathCtx = acquireXPathContext();
+		if (xpathCtx == nullptr)
+			return nullptr;
+
+		if (startingNode == nullptr)
+			xpathCtx->node = xmlDocGetRootElement(_doc);
+		else
+			xpathCtx->node = startingNode;
+
+		resultToBeFreed = xmlXPathCompiledEval(compiledXPath.compExpr, xpathCtx);
+		releaseXPathContext(xpathCtx);
+	}
+	if (measured)
+		recordXPathEvaluation(
+			compiledXPath, chrono::steady_clock::now() - start, resultToBeFreed == nullptr || xmlXPathNodeSetIsEmpty(resultToBeFreed->nodesetval),
+			resultToBeFreed != nullptr && resultToBeFreed->nodesetval != nullptr ? resultToBeFreed->nodesetval->nodeNr : 0
+		);
+	if (resultToBeFreed != nullptr && xmlXPathNodeSetIsEmpty(resultToBeFreed->nodesetval))
+	{
+		xmlXPathFreeObject(resultToBeFreed);
+		resultToBeFreed = nullptr;
+	}
+
+	return resultToBeFreed;
+}
+
+xmlXPathObjectPtr XMLWrapper::tryXPath(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	PreparedXPath preparedXPath = compiledXPath(xPathExpression);
+	if (preparedXPath == nullptr)
+		return nullptr;
+
+	return evalXPath(*preparedXPath, startingNode);
+}
+
+optional<xmlNodePtr> XMLWrapper::firstSimpleNode(const CompiledXPath &compiledXPath, xmlNodePtr startingNode) const
+{
+	if (compiledXPath.simplePath == nullptr)
+		return nullopt;
+	if (_doc == nullptr)
+		return nullptr;
+
+	const bool measured = metricsEnabled.load(memory_order_relaxed);
+	chrono::steady_clock::time_point start;
+	if (measured)
+		start = chrono::steady_clock::now();
+
+	xmlNodePtr firstNode = nullptr;
+	auto stopAtFirst = [&firstNode](xmlNodePtr node)
+	{
+		firstNode = node;
+		return false;
+	};
+	if (xmlNodePtr contextNode = simplePathContext(*compiledXPath.simplePath, _doc, startingNode); contextNode != nullptr)
+		walkSimplePath(*compiledXPath.simplePath, 0, contextNode, _nameServices, stopAtFirst);
+	if (measured)
+		recordXPathEvaluation(compiledXPath, chrono::steady_clock::now() - start, firstNode == nullptr, firstNode == nullptr ? 0 : 1);
+
+	return firstNode;
+}
+
+void XMLWrapper::throwXPathError(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	// only on the error path the expression is evaluated again, by xPath, to report why nothing was selected
+	const XPathResult result(xPath(xPathExpression, startingNode, false));
+
+	string errorMessage = std::format(
+		"xPath selected what the lookup did not"
+		", xPathExpression: {}",
+		xPathExpression
+	);
+	LOG_ERROR(errorMessage);
+
+	throw runtime_error(errorMessage);
+}
+
+xmlNodePtr XMLWrapper::tryFirstNode(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	PreparedXPath preparedXPath = compiledXPath(xPathExpression);
+	if (preparedXPath == nullptr)
+		return nullptr;
+
+	return tryFirstNode(*preparedXPath, startingNode);
+}
+
+xmlNodePtr XMLWrapper::tryFirstNode(const CompiledXPath &compiledXPath, xmlNodePtr startingNode) const
+{
+	if (optional<xmlNodePtr> node = firstSimpleNode(compiledXPath, startingNode))
+		return *node;
+
+	const XPathResult result(evalXPath(compiledXPath, startingNode));
+
+	return result.empty() ? nullptr : result[0];
+}
+
+xmlXPathObjectPtr XMLWrapper::xPath(const PreparedXPath &preparedXPath, xmlNodePtr startingNode, bool noErrorLog) const
+{
+	xmlXPathObjectPtr resultToBeFreed = nullptr;
+	try
+	{
+		if (_doc == nullptr)
+		{
+			string errorMessage = std::format("Document not initialized");
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
+		}
+
+		{
+			resultToBeFreed = evalXPath(*preparedXPath, startingNode);
+			if (resultToBeFreed == nullptr)
+			{
+				string errorMessage = std::format(
+					"xmlXPathCompiledEval failed"
+					", xPathExpression: {}", // ", nodeDump: {}",
+					preparedXPath->expression //, nodeToString(startingNode)
+				);
+				if (!noErrorLog)
+					LOG_ERROR(errorMessage);
+
+				throw runtime_error(errorMessage);
+			}
+
+			/*
+			enum xmlXPathObjectType {
+				XPATH_UNDEFINED = 0
+				XPATH_NODESET = 1
+				XPATH_BOOLEAN = 2
+				XPATH_NUMBER = 3
+				XPATH_STRING = 4
+				XPATH_POINT = 5
+				XPATH_RANGE = 6
+				XPATH_LOCATIONSET = 7
+				XPATH_USERS = 8
+				XPATH_XSLT_TREE = 9
+			};
+			enum xmlElementType {
+				XML_ELEMENT_NODE = 1
+				XML_ATTRIBUTE_NODE = 2
+				XML_TEXT_NODE = 3
+				XML_CDATA_SECTION_NODE = 4
+				XML_ENTITY_REF_NODE = 5
+				XML_ENTITY_NODE = 6
+				XML_PI_NODE = 7
+				XML_COMMENT_NODE = 8
+				XML_DOCUMENT_NODE = 9
+				XML_DOCUMENT_TYPE_NODE = 10
+				XML_DOCUMENT_FRAG_NODE = 11
+				XML_NOTATION_NODE = 12
+				XML_HTML_DOCUMENT_NODE = 13
+				XML_DTD_NODE = 14
+				XML_ELEMENT_DECL = 15
+				XML_ATTRIBUTE_DECL = 16
+				XML_ENTITY_DECL = 17
+				XML_NAMESPACE_DECL = 18
+				XML_XINCLUDE_START = 19
+				XML_XINCLUDE_END = //  XML_DOCB_DOCUMENT_NODE= 21 removed
+			};
+			*/
+			/*
+			LOG_INFO("xmlXPathEvalExpression"
+				", xPathExpression: {}"
+				", type: {}"
+				", name[0]: {}"
+				", type[0]: {}"
+				", content[0]: {}"
+				", children[0]->content: {}"
+				,
+				xPathExpression, (int) resultToBeFreed->type,
+				(resultToBeFreed->type == XPATH_NODESET && resultToBeFreed->nodesetval->nodeNr > 0 ?
+					(char *) resultToBeFreed->nodesetval->nodeTab[0]->name : ""),
+				(resultToBeFreed->type == XPATH_NODESET && resultToBeFreed->nodesetval->nodeNr > 0 ?
+					(int) resultToBeFreed->nodesetval->nodeTab[0]->type : -1),
+				(resultToBeFreed->type == XPATH_NODESET && resultToBeFreed->nodesetval->nodeNr > 0
+					&& resultToBeFreed->nodesetval->nodeTab[0]->type == XML_TEXT_NODE ?
+					(char *) resultToBeFreed->nodesetval->nodeTab[0]->content : ""),
+				(resultToBeFreed->type == XPATH_NODESET && resultToBeFreed->nodesetval->nodeNr > 0
+					&& resultToBeFreed->nodesetval->nodeTab[0]->type == XML_ATTRIBUTE_NODE ?
+					(char *) resultToBeFreed->nodesetval->nodeTab[0]->children->content : "")
+			);
+			*/
+
+			// node = resultToBeFreed->nodesetval->nodeTab[0];
+		}
+
+		// xmlXPathFreeObject(resultToBeFreed);
+
+		return resultToBeFreed;
+	}
+	catch (const exception &e)
+	{
+		if (!noErrorLog)
+			LOG_ERROR(
+				"xPath failed"
+				", xPathExpression: {}"
+				", exception: {}",
+				preparedXPath->expression, e.what()
+			);
+
+		if (resultToBeFreed)
+		{
+			xmlXPathFreeObject(resultToBeFreed);
+			resultToBeFreed = nullptr;
+		}
+
+		throw;
+	}
+}
+
+optional<string_view> XMLWrapper::tryAttributeView(xmlNodePtr node, const string &attributeName)
+{
+	if (node == nullptr || node->type != XML_ELEMENT_NODE)
+		return nullopt;
+
+	// same matching as xmlGetProp: by name, independently of the namespace
+	for (xmlAttrPtr attribute = node->properties; attribute != nullptr; attribute = attribute->next)
+	{
+		if (!xmlStrEqual(attribute->name, BAD_CAST attributeName.c_str()))
+			continue;
+
+		if (attribute->children == nullptr)
+			return ""sv;
+		// the value is split in more nodes only in case of entity references
+		if (attribute->children->next != nullptr || attribute->children->content == nullptr)
+			return nullopt;
+
+		return reinterpret_cast<const char *>(attribute->children->content);
+	}
+
+	return nullopt;
+}
+
+optional<string> XMLWrapper::tryAttribute(xmlNodePtr node, const string &attributeName)
+{
+	if (node == nullptr)
+		return nullopt;
+
+	if (optional<string_view> attributeView = tryAttributeView(node, attributeName))
+		return string(*attributeView);
+
+	// entity references or DTD default values
+	xmlChar *attributeValue = xmlGetProp(node, BAD_CAST attributeName.c_str());
+	if (attributeValue == nullptr)
+		return nullopt;
+
+	optional<string> sAttributeValue;
+	try
+	{
+		sAttributeValue = reinterpret_cast<char *>(attributeValue);
+	}
+	catch (...)
+	{
+		xmlFree(attributeValue);
+
+		throw;
+	}
+	xmlFree(attributeValue);
+
+	return sAttributeValue;
+}
+
+optional<string_view> XMLWrapper::tryAttributeView(const string &xPathExpression, const string &attributeName, xmlNodePtr startingNode) const
+{
+	return tryAttributeView(tryFirstNode(xPathExpression, startingNode), attributeName);
+}
+
+optional<string> XMLWrapper::tryAttribute(const string &xPathExpression, const string &attributeName, xmlNodePtr startingNode) const
+{
+	return tryAttribute(tryFirstNode(xPathExpression, startingNode), attributeName);
+}
+
+string XMLWrapper::asAttribute(xmlNodePtr node, const string& attributeName, bool emptyOnError)
+{
+	optional<string> attributeValue = tryAttribute(node, attributeName);
+	if (attributeValue)
+		return std::move(*attributeValue);
+
+	if (emptyOnError)
+		return "";
+
+	LOG_ERROR(
+		"asAttribute failed"
+		", node->name: {}"
+		", attributeName: {}",
+		node == nullptr ? "" : (char *)node->name, attributeName
+	);
+
+	throw runtime_error(std::format("attribute {} not found", attributeName));
+}
+
+string XMLWrapper::asAttribute(string xPathExpression, const string& attributeName, xmlNodePtr startingNode, bool emptyOnError) const
+{
+	if (emptyOnError)
+		return tryAttribute(xPathExpression, attributeName, startingNode).value_or("");
+
+	try
+	{
+		xmlNodePtr node = tryFirstNode(xPathExpression, startingNode);
+		if (node == nullptr)
+			throwXPathError(xPathExpression, startingNode);
+
+		return asAttribute(node, attributeName, false);
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"asAttribute failed"
+			", xPathExpression: {}"
+			", exception: {}",
+			xPathExpression, e.what()
+		);
+
+		throw;
+	}
+}
+
+bool XMLWrapper::setAttribute(const std::string& xPathExpression,
+	const size_t nodeIndex, // starting from 0
+	const std::string& attributeName,
+	const std::string& attributeValue,
+	xmlNodePtr startingNode) const
+{
+    try
+    {
+        xmlXPathObjectPtr resultToBeFreed = xPath(xPathExpression, startingNode, false);
+    	const XPathResult guard(resultToBeFreed);
+
+        if (!resultToBeFreed
+        	|| !resultToBeFreed->nodesetval
+        	|| resultToBeFreed->nodesetval->nodeNr <= nodeIndex)
+        {
+        	string errorMessage = std::format("setAttribute failed, node not found"
+				", xPathExpression: {}"
+				", nodeNr: {}"
+				", nodeIndex: {}",
+				xPathExpression, resultToBeFreed && resultToBeFreed->nodesetval ? resultToBeFreed->nodesetval->nodeNr : -1,
+				nodeIndex);
+        	LOG_ERROR(errorMessage);
+
+            throw std::runtime_error(errorMessage);
+        }
+
+        xmlNodePtr node = resultToBeFreed->nodesetval->nodeTab[nodeIndex];
+        if (!node)
+        {
+			const string errorMessage = std::format("setAttribute failed, node not found"
+				", xPathExpression: {}",
+				xPathExpression);
+        	LOG_ERROR(errorMessage);
+
+        	throw std::runtime_error(errorMessage);
+        }
+
+        // the previous value is needed only to move the node inside an index on this attribute
+        bool attributeIndexed;
+        optional<string> previousValue;
+        {
+        	lock_guard<mutex> locker(_attributeIndexesMutex);
+        	attributeIndexed = ranges::any_of(
+        		_attributeIndexes, [&attributeName](const auto &index)
+        		{ return index.first.second == attributeName || selectsByPredicate(index.first.first); }
+        	);
+        	if (attributeIndexed)
+        		previousValue = tryAttribute(node, attributeName);
+        }
+
+        // Set (create or replace) the attribute.
+        // xmlSetProp returns xmlAttrPtr (nullptr on error).
+        xmlAttrPtr a;
+        {
+        	ArenaScope arenaScope(_arena.get());
+        	a = xmlSetProp(node, BAD_CAST attributeName.c_str(), BAD_CAST attributeValue.c_str());
+        }
+
+        if (!a)
+        {
+        	string errorMessage = std::format("setAttribute failed"
+				", xPathExpression: {}"
+				", attributeName: {}",
+				xPathExpression, attributeName);
+        	LOG_ERROR(errorMessage);
+
+            throw std::runtime_error(errorMessage);
+        }
+
+        if (attributeIndexed)
+        {
+        	lock_guard<mutex> locker(_attributeIndexesMutex);
+        	for (auto it = _attributeIndexes.begin(); it != _attributeIndexes.end();)
+        	{
+        		// the element expression may select the node or not depending on the attribute: the index is rebuilt on demand
+        		if (selectsByPredicate(it->first.first))
+        		{
+        			it = _attributeIndexes.erase(it);
+        			continue;
+        		}
+        		if (it->first.second != attributeName)
+        		{
+        			++it;
+        			continue;
+        		}
+
+        		AttributeIndex &index = it->second;
+        		auto previousNodes = previousValue ? index.find(*previousValue) : index.end();
+        		auto indexedNode = previousNodes == index.end() ? vector<xmlNodePtr>::iterator() : ranges::find(previousNodes->second, node);
+        		if (previousNodes == index.end() || indexedNode == previousNodes->second.end())
+        		{
+        			// the node was not indexed, it is not known if it is selected by the element expression: the index is rebuilt on demand
+        			it = _attributeIndexes.erase(it);
+        			continue;
+        		}
+        		previousNodes->second.erase(indexedNode);
+        		if (previousNodes->second.empty())
+        			index.erase(previousNodes);
+
+        		// document order is kept inside the list of a value
+        		vector<xmlNodePtr> &nodes = index[attributeValue];
+        		nodes.insert(ranges::upper_bound(nodes, node, [](xmlNodePtr a, xmlNodePtr b) { return xmlXPathCmpNodes(a, b) > 0; }), node);
+        		++it;
+        	}
+        }
+
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("setAttribute failed"
+        	", xPathExpression: {}"
+        	", exception: {}",
+        	xPathExpression, e.what());
+
+        throw;
+    }
+}
+
+const XMLWrapper::AttributeIndex &XMLWrapper::attributeIndex(const string &elementXPathExpression, const string &attributeName) const
+{
+	auto key = make_pair(elementXPathExpression, attributeName);
+	if (auto it = _attributeIndexes.find(key); it != _attributeIndexes.end())
+		return it->second;
+
+	AttributeIndex index;
+	for (xmlNodePtr node : select(elementXPathExpression))
+	{
+		if (node->type != XML_ELEMENT_NODE)
+			continue;
+		if (optional<string> value = tryAttribute(node, attributeName))
+			index[std::move(*value)].push_back(node);
+	}
+
+	return _attributeIndexes.emplace(std::move(key), std::move(index)).first->second;
+}
+
+void XMLWrapper::dropAttributeIndexes() const
+{
+	lock_guard<mutex> locker(_attributeIndexesMutex);
+	_attributeIndexes.clear();
+}
+
+void XMLWrapper::dropAttributeIndexes(const string &attributeName) const
+{
+	lock_guard<mutex> locker(_attributeIndexesMutex);
+	erase_if(
+		_attributeIndexes, [&attributeName](const auto &index) { return index.first.second == attributeName || selectsByPredicate(index.first.first); }
+	);
+}
+
+size_t XMLWrapper::buildAttributeIndex(const string &elementXPathExpression, const string &attributeName) const
+{
+	lock_guard<mutex> locker(_attributeIndexesMutex);
+	return attributeIndex(elementXPathExpression, attributeName).size();
+}
+
+xmlNodePtr XMLWrapper::findByAttribute(const string &elementXPathExpression, const string &attributeName, const string &attributeValue) const
+{
+	lock_guard<mutex> locker(_attributeIndexesMutex);
+	const AttributeIndex &index = attributeIndex(elementXPathExpression, attributeName);
+	auto it = index.find(attributeValue);
+
+	return it == index.end() ? nullptr : it->second.front();
+}
+
+vector<xmlNodePtr> XMLWrapper::findAllByAttribute(const string &elementXPathExpression, const string &attributeName, const string &attributeValue) const
+{
+	lock_guard<mutex> locker(_attributeIndexesMutex);
+	const AttributeIndex &index = attributeIndex(elementXPathExpression, attributeName);
+	auto it = index.find(attributeValue);
+
+	return it == index.end() ? vector<xmlNodePtr>() : it->second;
+}
+
+optional<vector<string_view>> XMLWrapper::tryAttributeViewsList(const string &xPathExpression, const string &attributeName, xmlNodePtr startingNode) const
+{
+	xmlXPathObjectPtr resultToBeFreed = tryXPath(xPathExpression, startingNode);
+	if (resultToBeFreed == nullptr)
+		return nullopt;
+	const XPathResult guard(resultToBeFreed);
+
+	vector<string_view> attributes;
+	attributes.reserve(resultToBeFreed->nodesetval->nodeNr);
+	for (int nodeIndex = 0; nodeIndex < resultToBeFreed->nodesetval->nodeNr; nodeIndex++)
+	{
+		optional<string_view> attributeValue = tryAttributeView(resultToBeFreed->nodesetval->nodeTab[nodeIndex], attributeName);
+		if (!attributeValue)
+			return nullopt;
+		attributes.push_back(*attributeValue);
+	}
+
+	return attributes;
+}
+
+optional<vector<string>> XMLWrapper::tryAttributesList(const string &xPathExpression, const string &attributeName, xmlNodePtr startingNode) const
+{
+	xmlXPathObjectPtr resultToBeFreed = tryXPath(xPathExpression, startingNode);
+	if (resultToBeFreed == nullptr)
+		return nullopt;
+	const XPathResult guard(resultToBeFreed);
+
+	vector<string> attributes;
+	attributes.reserve(resultToBeFreed->nodesetval->nodeNr);
+	for (int nodeIndex = 0; nodeIndex < resultToBeFreed->nodesetval->nodeNr; nodeIndex++)
+	{
+		optional<string> attributeValue = tryAttribute(resultToBeFreed->nodesetval->nodeTab[nodeIndex], attributeName);
+		if (!attributeValue)
+			return nullopt;
+		attributes.push_back(std::move(*attributeValue));
+	}
+
+	return attributes;
+}
+
+vector<string> XMLWrapper::asAttributesList(const string& xPathExpression, const string& attributeName, xmlNodePtr startingNode, bool emptyOnError) const
+{
+	if (emptyOnError)
+		return tryAttributesList(xPathExpression, attributeName, startingNode).value_or(vector<string>());
+
+	try
+	{
+		const XPathResult result(tryXPath(xPathExpression, startingNode));
+		if (result.empty())
+			throwXPathError(xPathExpression, startingNode);
+
+		// a node without the attribute throws the error of asAttribute
+		vector<string> attributes;
+		attributes.reserve(result.size());
+		for (xmlNodePtr node : result)
+			attributes.push_back(asAttribute(node, attributeName));
+
+		return attributes;
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"asAttributesList failed"
+			", xPathExpression: {}"
+			", exception: {}",
+			xPathExpression, e.what()
+		);
+
+		throw;
+	}
+}
+
+string_view XMLWrapper::nodeTextView(xmlNodePtr node)
+{
+	const xmlChar *content = node->type == XML_ELEMENT_NODE || node->type == XML_ATTRIBUTE_NODE ? (node->children == nullptr ? nullptr : node->children->content)
+																								 : node->content;
+
+	return content == nullptr ? ""sv : string_view(reinterpret_cast<const char *>(content));
+}
+
+string XMLWrapper::nodeText(xmlNodePtr node) { return string(nodeTextView(node)); }
+
+optional<vector<string_view>> XMLWrapper::tryTextViewList(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	xmlXPathObjectPtr resultToBeFreed = tryXPath(xPathExpression, startingNode);
+	if (resultToBeFreed == nullptr)
+		return nullopt;
+	const XPathResult guard(resultToBeFreed);
 
-			throw XMLReadMemory(errorMessage);
-		}
+	vector<string_view> textList;
+	textList.reserve(resultToBeFreed->nodesetval->nodeNr);
+	for (int nodeIndex = 0; nodeIndex < resultToBeFreed->nodesetval->nodeNr; nodeIndex++)
+		textList.push_back(nodeTextView(resultToBeFreed->nodesetval->nodeTab[nodeIndex]));
 
-		/* Create xpath evaluation context */
-		_xpathCtx = xmlXPathNewContext(_doc);
-		if (_xpathCtx == nullptr)
-		{
-			string errorMessage = std::format(
-				"The xmlReadMemory failed"
-				", url: {}",
-				url
-			);
-			LOG_ERROR(errorMessage);
+	return textList;
+}
 
-			throw runtime_error(errorMessage);
-		}
+optional<vector<string>> XMLWrapper::tryTextList(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	xmlXPathObjectPtr resultToBeFreed = tryXPath(xPathExpression, startingNode);
+	if (resultToBeFreed == nullptr)
+		return nullopt;
+	const XPathResult guard(resultToBeFreed);
+
+	vector<string> textList;
+	textList.reserve(resultToBeFreed->nodesetval->nodeNr);
+	for (int nodeIndex = 0; nodeIndex < resultToBeFreed->nodesetval->nodeNr; nodeIndex++)
+		textList.push_back(nodeText(resultToBeFreed->nodesetval->nodeTab[nodeIndex]));
+
+	return textList;
+}
 
-		_xpathCtx->node = xmlDocGetRootElement(_doc);  // context node = <entry>
+vector<string> XMLWrapper::asTextList(const string& xPathExpression, xmlNodePtr startingNode, bool emptyOnError) const
+{
+	optional<vector<string>> textList = tryTextList(xPathExpression, startingNode);
+	if (textList || emptyOnError)
+		return std::move(textList).value_or(vector<string>());
 
-		for (const pair<string, string>& nameService : nameServices)
-			xmlXPathRegisterNs(_xpathCtx, BAD_CAST nameService.first.c_str(), BAD_CAST nameService.second.c_str());
+	try
+	{
+		throwXPathError(xPathExpression, startingNode);
 	}
 	catch (const exception &e)
 	{
 		LOG_ERROR(
-			"loadXML failed"
-			", url: {}"
+			"asTextList failed"
+			", xPathExpression: {}"
 			", exception: {}",
-			url, e.what()
+			xPathExpression, e.what()
 		);
 
-		finish();
-
 		throw;
 	}
 }
 
-string XMLWrapper::asString(const bool pretty) const
+string_view XMLWrapper::textViewOf(xmlNodePtr node)
 {
-	xmlChar* mem = nullptr;
-	try
-	{
-		if (!_doc)
-		{
-			const string errorMessage = "Document not initialized";
-			LOG_ERROR(errorMessage);
+	if (node->type == XML_TEXT_NODE || node->type == XML_ATTRIBUTE_NODE)
+		return nodeTextView(node);
 
-			throw runtime_error(errorMessage);
-		}
-
-		/*
-		// Assicura versione/encoding (così libxml2 emette la declaration)
-		if (!_doc->version)
-			_doc->version = xmlStrdup(BAD_CAST "1.0");
-
-		// Imposta l'encoding: xmlCharEncodingHandler viene scelto dal nome ("UTF-8")
-		// Nota: doc->encoding è xmlChar*, va allocata con funzioni libxml2.
-		if (!_doc->encoding)
-			_doc->encoding = xmlStrdup(BAD_CAST "UTF-8");
-		*/
+	return ""sv;
+}
 
-		int size = 0;
-		if (pretty)
-			xmlDocDumpFormatMemoryEnc(_doc, &mem, &size, "UTF-8", 1);
-		else
-			xmlDocDumpMemoryEnc(_doc, &mem, &size, "UTF-8");
-		if (!mem || size <= 0)
-		{
-			const string errorMessage = std::format(
-				"xmlDocDumpMemoryEnc failed"
-				", size: {}", size
-				);
-			LOG_ERROR(errorMessage);
+optional<string_view> XMLWrapper::tryTextView(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	xmlNodePtr node = tryFirstNode(xPathExpression, startingNode);
+	if (node == nullptr)
+		return nullopt;
 
-			if (mem)
-				xmlFree(mem);
+	return textViewOf(node);
+}
 
-			throw runtime_error(errorMessage);
-		}
+optional<string> XMLWrapper::tryText(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	optional<string_view> text = tryTextView(xPathExpression, startingNode);
+	if (!text)
+		return nullopt;
 
-		std::string sXML(reinterpret_cast<char*>(mem), static_cast<size_t>(size));
-		xmlFree(mem);
+	return string(*text);
+}
 
-		// vedi commento nel metodo loadXML
-		// sXML = StringUtils::replaceAll(sXML, "xmlns:mio=", "xmlns=");
+string XMLWrapper::asText(const string& xPathExpression, xmlNodePtr startingNode, bool emptyOnError) const
+{
+	optional<string> text = tryText(xPathExpression, startingNode);
+	if (text || emptyOnError)
+		return std::move(text).value_or("");
 
-		return sXML;
+	try
+	{
+		throwXPathError(xPathExpression, startingNode);
 	}
 	catch (const exception &e)
 	{
 		LOG_ERROR(
-			"asString failed"
+			"asText failed"
+			", xPathExpression: {}"
 			", exception: {}",
-			e.what()
+			xPathExpression, e.what()
 		);
 
-		if (mem)
-			xmlFree(mem);
-
 		throw;
 	}
 }
 
-void XMLWrapper::saveXMLFile(string pathName, bool pretty) const
+XMLWrapper::Columns XMLWrapper::extract(
+	const string &recordXPathExpression, const vector<pair<string, string>> &fields, xmlNodePtr startingNode, size_t threadsNumber
+) const
 {
 	try
 	{
-		string sXML = asString(pretty);
+		// every expression is compiled once, an invalid one is reported before starting
+		vector<PreparedXPath> fieldXPaths;
+		fieldXPaths.reserve(fields.size());
+		Columns columns;
+		columns.fieldNames.reserve(fields.size());
+		for (const auto &[fieldName, fieldXPathExpression] : fields)
+		{
+			fieldXPaths.push_back(prepareXPath(fieldXPathExpression));
+			columns.fieldNames.push_back(fieldName);
+		}
+
+		const XPathResult records(evalXPath(*prepareXPath(recordXPathExpression), startingNode));
+
+		columns.records = records.size();
+		columns.values.assign(fields.size(), vector<string>(columns.records));
+		if (columns.records == 0)
+			return columns;
 
-		std::ofstream out(pathName, std::ios::binary); // binary evita conversioni newline
-		if (!out)
+		// every thread fills a contiguous range of records, the cells are distinct so no synchronization is needed
+		auto extractRecords = [&](const size_t firstRecord, const size_t lastRecord)
 		{
-			const string errorMessage = std::format("Creation of file failed"
-				", pathName: {}", pathName
-				);
-			LOG_ERROR(errorMessage);
+			for (size_t recordIndex = firstRecord; recordIndex < lastRecord; recordIndex++)
+			{
+				xmlNodePtr recordNode = records[recordIndex];
+				// only the first node of a field is read: a simple path stops the tree walk there, without any node set
+				for (size_t fieldIndex = 0; fieldIndex < fieldXPaths.size(); fieldIndex++)
+					if (xmlNodePtr field = tryFirstNode(*fieldXPaths[fieldIndex], recordNode); field != nullptr)
+						columns.values[fieldIndex][recordIndex] = textViewOf(field);
+			}
+		};
 
-			throw runtime_error(errorMessage);
+		if (threadsNumber == 0)
+			threadsNumber = max(thread::hardware_concurrency(), 1u);
+		// it does not make sense to start a thread for few records
+		threadsNumber = min(threadsNumber, (columns.records + 63) / 64);
+		if (threadsNumber <= 1)
+		{
+			extractRecords(0, columns.records);
+
+			return columns;
 		}
 
-		out.write(sXML.data(), static_cast<std::streamsize>(sXML.size()));
+		const size_t recordsPerThread = (columns.records + threadsNumber - 1) / threadsNumber;
+		vector<exception_ptr> exceptions(threadsNumber);
+		vector<thread> threads;
+		threads.reserve(threadsNumber);
+		for (size_t threadIndex = 0; threadIndex < threadsNumber; threadIndex++)
+			threads.emplace_back(
+				[&, threadIndex]()
+				{
+					try
+					{
+						extractRecords(threadIndex * recordsPerThread, min((threadIndex + 1) * recordsPerThread, columns.records));
+					}
+					catch (...)
+					{
+						exceptions[threadIndex] = current_exception();
+					}
+				}
+			);
+		for (thread &thread : threads)
+			thread.join();
+		for (const exception_ptr &exception : exceptions)
+			if (exception)
+				rethrow_exception(exception);
+
+		return columns;
 	}
 	catch (const exception &e)
 	{
 		LOG_ERROR(
-			"saveXML failed"
-			", pathName: {}"
+			"extract failed"
+			", recordXPathExpression: {}"
 			", exception: {}",
-			pathName, e.what()
+			recordXPathExpression, e.what()
 		);
 
 		throw;
 	}
 }
 
-xmlNodePtr XMLWrapper::asRootNode() const
+void XMLWrapper::setElementText(const string& xPathExpression, xmlNodePtr startingNode, const std::string& newText) const
 {
 	try
 	{
-		if (_doc == nullptr)
+		xmlXPathObjectPtr resultToBeFreed = xPath(xPathExpression, startingNode, false);
+		const XPathResult guard(resultToBeFreed);
+
+		if (!resultToBeFreed
+			|| !resultToBeFreed->nodesetval
+			|| resultToBeFreed->nodesetval->nodeNr <= 0)
 		{
-			string errorMessage = std::format("Document not initialized");
+			string errorMessage = std::format("setElementText failed, node not found"
+				", xPathExpression: {}"
+				", nodeNr: {}",
+				xPathExpression, resultToBeFreed && resultToBeFreed->nodesetval ? resultToBeFreed->nodesetval->nodeNr : -1);
 			LOG_ERROR(errorMessage);
 
-			throw runtime_error(errorMessage);
+			throw std::runtime_error(errorMessage);
 		}
 
-		return xmlDocGetRootElement(_doc);
+		xmlNodePtr node = resultToBeFreed->nodesetval->nodeTab[0];
+		if (!node || node->type != XML_ELEMENT_NODE)
+		{
+			const string errorMessage = std::format("setElementText failed, element node not found"
+				", xPathExpression: {}",
+				xPathExpression);
+			LOG_ERROR(errorMessage);
+
+			throw std::runtime_error(errorMessage);
+		}
+
+		// the children of the element are freed, indexed elements among them
+		dropAttributeIndexes();
+
+		ArenaScope arenaScope(_arena.get());
+		xmlNodeSetContent(node, BAD_CAST newText.c_str());
 	}
 	catch (const exception &e)
 	{
 		LOG_ERROR(
-			"asRootNode failed"
+			"setElementText failed"
+			", xPathExpression: {}"
 			", exception: {}",
-			e.what()
+			xPathExpression, e.what()
 		);
 
 		throw;
 	}
 }
 
-xmlXPathObjectPtr XMLWrapper::xPath(const string& xPathExpression, xmlNodePtr startingNode, bool noErrorLog) const
+bool XMLWrapper::applyEdit(
+	xmlNodePtr node, const NodeEdit::Type type, const string &name, const string &value, vector<xmlNodePtr> &unlinkedNodes
+) const
 {
-	xmlXPathObjectPtr resultToBeFreed = nullptr;
-	try
+	if (type == NodeEdit::Type::Remove)
 	{
-		if (_doc == nullptr)
+		if (node->type == XML_DOCUMENT_NODE || node->type == XML_NAMESPACE_DECL)
+			return false;
+		// already removed by a previous edit
+		if (node->parent == nullptr)
+			return true;
+		xmlUnlinkNode(node);
+		unlinkedNodes.push_back(node);
+
+		return true;
+	}
+	if (node->type != XML_ELEMENT_NODE)
+		return false;
+
+	switch (type)
+	{
+	case NodeEdit::Type::SetAttribute:
+		if (xmlSetProp(node, BAD_CAST name.c_str(), BAD_CAST value.c_str()) == nullptr)
 		{
-			string errorMessage = std::format("Document not initialized");
+			string errorMessage = std::format(
+				"xmlSetProp failed"
+				", attributeName: {}",
+				name
+			);
 			LOG_ERROR(errorMessage);
 
 			throw runtime_error(errorMessage);
 		}
+		break;
+	case NodeEdit::Type::RemoveAttribute:
+		if (xmlAttrPtr attribute = xmlHasProp(node, BAD_CAST name.c_str()); attribute != nullptr && attribute->type == XML_ATTRIBUTE_NODE)
+		{
+			xmlUnlinkNode(reinterpret_cast<xmlNodePtr>(attribute));
+			unlinkedNodes.push_back(reinterpret_cast<xmlNodePtr>(attribute));
+		}
+		break;
+	case NodeEdit::Type::SetText:
+		// the children are unlinked instead of being freed by xmlNodeSetContent, other edits may refer to them
+		while (node->children != nullptr)
+		{
+			xmlNodePtr child = node->children;
+			xmlUnlinkNode(child);
+			unlinkedNodes.push_back(child);
+		}
+		xmlNodeSetContent(node, BAD_CAST value.c_str());
+		break;
+	case NodeEdit::Type::AddChild:
+		// the child inherits the namespace of node
+		if (xmlNewChild(node, nullptr, BAD_CAST name.c_str(), value.empty() ? nullptr : BAD_CAST value.c_str()) == nullptr)
+		{
+			string errorMessage = std::format(
+				"xmlNewChild failed"
+				", childName: {}",
+				name
+			);
+			LOG_ERROR(errorMessage);
 
-		if (startingNode == nullptr)
-			_xpathCtx->node = xmlDocGetRootElement(_doc);
-		else
-			_xpathCtx->node = startingNode;
+			throw runtime_error(errorMessage);
+		}
+		break;
+	case NodeEdit::Type::Remove:
+		break;
+	}
 
-		xmlNodePtr node = nullptr;
-		{
-			resultToBeFreed = xmlXPathEvalExpression(BAD_CAST xPathExpression.c_str(), _xpathCtx);
-			if (!resultToBeFreed || xmlXPathNodeSetIsEmpty(resultToBeFreed->nodesetval))
-			{
-				string errorMessage = std::format(
-					"xmlXPathEvalExpression failed"
-					", xPathExpression: {}", // ", nodeDump: {}",
-					xPathExpression			 //, nodeToString(startingNode)
-				);
-				if (!noErrorLog)
-					LOG_ERROR(errorMessage);
+	return true;
+}
 
-				throw runtime_error(errorMessage);
-			}
+template <typename Edit> size_t XMLWrapper::editNodes(const Edit &edit) const
+{
+	vector<xmlNodePtr> unlinkedNodes;
+	auto freeUnlinkedNodes = [&unlinkedNodes]()
+	{
+		// a node of the arena is released together with it
+		for (xmlNodePtr node : unlinkedNodes)
+			xmlFreeNode(node);
+	};
 
-			/*
-			enum xmlXPathObjectType {
-				XPATH_UNDEFINED = 0
-				XPATH_NODESET = 1
-				XPATH_BOOLEAN = 2
-				XPATH_NUMBER = 3
-				XPATH_STRING = 4
-				XPATH_POINT = 5
-				XPATH_RANGE = 6
-				XPATH_LOCATIONSET = 7
-				XPATH_USERS = 8
-				XPATH_XSLT_TREE = 9
-			};
-			enum xmlElementType {
-				XML_ELEMENT_NODE = 1
-				XML_ATTRIBUTE_NODE = 2
-				XML_TEXT_NODE = 3
-				XML_CDATA_SECTION_NODE = 4
-				XML_ENTITY_REF_NODE = 5
-				XML_ENTITY_NODE = 6
-				XML_PI_NODE = 7
-				XML_COMMENT_NODE = 8
-				XML_DOCUMENT_NODE = 9
-				XML_DOCUMENT_TYPE_NODE = 10
-				XML_DOCUMENT_FRAG_NODE = 11
-				XML_NOTATION_NODE = 12
-				XML_HTML_DOCUMENT_NODE = 13
-				XML_DTD_NODE = 14
-				XML_ELEMENT_DECL = 15
-				XML_ATTRIBUTE_DECL = 16
-				XML_ENTITY_DECL = 17
-				XML_NAMESPACE_DECL = 18
-				XML_XINCLUDE_START = 19
-				XML_XINCLUDE_END = //  XML_DOCB_DOCUMENT_NODE= 21 removed
-			};
-			*/
-			/*
-			LOG_INFO("xmlXPathEvalExpression"
-				", xPathExpression: {}"
-				", type: {}"
-				", name[0]: {}"
-				", type[0]: {}"
-				", content[0]: {}"
-				", children[0]->content: {}"
-				,
-				xPathExpression, (int) resultToBeFreed->type,
-				(resultToBeFreed->type == XPATH_NODESET && resultToBeFreed->nodesetval->nodeNr > 0 ?
-					(char *) resultToBeFreed->nodesetval->nodeTab[0]->name : ""),
-				(resultToBeFreed->type == XPATH_NODESET && resultToBeFreed->nodesetval->nodeNr > 0 ?
-					(int) resultToBeFreed->nodesetval->nodeTab[0]->type : -1),
-				(resultToBeFreed->type == XPATH_NODESET && resultToBeFreed->nodesetval->nodeNr > 0
-					&& resultToBeFreed->nodesetval->nodeTab[0]->type == XML_TEXT_NODE ?
-					(char *) resultToBeFreed->nodesetval->nodeTab[0]->content : ""),
-				(resultToBeFreed->type == XPATH_NODESET && resultToBeFreed->nodesetval->nodeNr > 0
-					&& resultToBeFreed->nodesetval->nodeTab[0]->type == XML_ATTRIBUTE_NODE ?
-					(char *) resultToBeFreed->nodesetval->nodeTab[0]->children->content : "")
-			);
-			*/
+	size_t edited;
+	try
+	{
+		ArenaScope arenaScope(_arena.get());
+		edited = edit(unlinkedNodes);
+	}
+	catch (...)
+	{
+		freeUnlinkedNodes();
 
-			// node = resultToBeFreed->nodesetval->nodeTab[0];
+		throw;
+	}
+	freeUnlinkedNodes();
+
+	return edited;
+}
+
+size_t XMLWrapper::editAll(
+	const string &xPathExpression, xmlNodePtr startingNode, const NodeEdit::Type type, const string &name, const string &value
+) const
+{
+	const XPathResult nodes = select(xPathExpression, startingNode);
+	if (nodes.empty())
+		return 0;
+
+	if (type == NodeEdit::Type::SetAttribute || type == NodeEdit::Type::RemoveAttribute)
+		dropAttributeIndexes(name);
+	else
+		dropAttributeIndexes();
+
+	return editNodes(
+		[&](vector<xmlNodePtr> &unlinkedNodes)
+		{
+			size_t edited = 0;
+			for (xmlNodePtr node : nodes)
+				edited += applyEdit(node, type, name, value, unlinkedNodes);
+
+			return edited;
 		}
+	);
+}
+
+size_t XMLWrapper::setAttributeAll(const string &xPathExpression, const string &attributeName, const string &attributeValue, xmlNodePtr startingNode)
+	const
+{
+	try
+	{
+		return editAll(xPathExpression, startingNode, NodeEdit::Type::SetAttribute, attributeName, attributeValue);
+	}
+	catch (const exception &e)
+	{
+		LOG_ERROR(
+			"setAttributeAll failed"
+			", xPathExpression: {}"
+			", attributeName: {}"
+			", exception: {}",
+			xPathExpression, attributeName, e.what()
+		);
 
-		// xmlXPathFreeObject(resultToBeFreed);
+		throw;
+	}
+}
 
-		return resultToBeFreed;
+size_t XMLWrapper::setElementTextAll(const string &xPathExpression, const string &newText, xmlNodePtr startingNode) const
+{
+	try
+	{
+		return editAll(xPathExpression, startingNode, NodeEdit::Type::SetText, "", newText);
 	}
 	catch (const exception &e)
 	{
-		if (!noErrorLog)
-			LOG_ERROR(
-				"xPath failed"
-				", xPathExpression: {}"
-				", exception: {}",
-				xPathExpression, e.what()
-			);
-
-		if (resultToBeFreed)
-		{
-			xmlXPathFreeObject(resultToBeFreed);
-			resultToBeFreed = nullptr;
-		}
+		LOG_ERROR(
+			"setElementTextAll failed"
+			", xPathExpression: {}"
+			", exception: {}",
+			xPathExpression, e.what()
+		);
 
 		throw;
 	}
 }
 
-string XMLWrapper::asAttribute(xmlNodePtr node, const string& attributeName, bool emptyOnError)
+size_t XMLWrapper::addChildElementAll(const string &xPathExpression, const string &childName, const string &childText, xmlNodePtr startingNode)
+	const
 {
-	xmlChar *attributeValue = nullptr;
 	try
 	{
-		attributeValue = xmlGetProp(node, BAD_CAST attributeName.c_str());
-		if (attributeValue == nullptr)
-		{
-			string errorMessage = std::format("attribute {} not found", attributeName);
-
-			throw runtime_error(errorMessage);
-		}
-		string sAttributeValue = reinterpret_cast<char *>(attributeValue);
-		xmlFree(attributeValue);
-		attributeValue = nullptr;
-
-		return sAttributeValue;
+		return editAll(xPathExpression, startingNode, NodeEdit::Type::AddChild, childName, childText);
 	}
 	catch (const exception &e)
 	{
-		if (attributeValue != nullptr)
-			xmlFree(attributeValue);
-
-		if (emptyOnError)
-			return "";
-
 		LOG_ERROR(
-			"asAttribute failed"
-			", node->name: {}"
-			", attributeName: {}",
-			node == nullptr ? "" : (char *)node->name, attributeName
+			"addChildElementAll failed"
+			", xPathExpression: {}"
+			", childName: {}"
+			", exception: {}",
+			xPathExpression, childName, e.what()
 		);
 
 		throw;
 	}
 }
 
-string XMLWrapper::asAttribute(string xPathExpression, const string& attributeName, xmlNodePtr startingNode, bool emptyOnError) const
+size_t XMLWrapper::removeNodes(const string &xPathExpression, xmlNodePtr startingNode) const
 {
 	try
 	{
-		xmlXPathObjectPtr resultToBeFreed = xPath(xPathExpression, startingNode, emptyOnError);
-		struct XpGuard {
-			xmlXPathObjectPtr _resultToBeFreed;
-			~XpGuard()
-			{
-				if(_resultToBeFreed)
-					xmlXPathFreeObject(_resultToBeFreed);
-			}
-		} guard{resultToBeFreed};
-
-		return asAttribute(resultToBeFreed->nodesetval->nodeTab[0], attributeName, emptyOnError);
+		return editAll(xPathExpression, startingNode, NodeEdit::Type::Remove, "", "");
 	}
 	catch (const exception &e)
 	{
-		if (emptyOnError)
-			return {};
-
 		LOG_ERROR(
-			"asAttribute failed"
+			"removeNodes failed"
 			", xPathExpression: {}"
 			", exception: {}",
 			xPathExpression, e.what()
@@ -424,292 +5508,294 @@ string XMLWrapper::asAttribute(string xPathExpression, const string& attributeNa
 	}
 }
 
-bool XMLWrapper::setAttribute(const std::string& xPathExpression,
-	const size_t nodeIndex, // starting from 0
-	const std::string& attributeName,
-	const std::string& attributeValue,
-	xmlNodePtr startingNode) const
+size_t XMLWrapper::applyEdits(const XPathResult &nodes, const vector<NodeEdit> &edits) const
 {
-    try
-    {
-        xmlXPathObjectPtr resultToBeFreed = xPath(xPathExpression, startingNode, false);
-    	struct XpGuard {
-    		xmlXPathObjectPtr _resultToBeFreed;
-    		~XpGuard()
-    		{
-    			if(_resultToBeFreed)
-    				xmlXPathFreeObject(_resultToBeFreed);
-    		}
-    	} guard{resultToBeFreed};
+	// validation first, a batch is not applied partially because of a wrong edit
+	bool onlyAttributes = true;
+	for (size_t editIndex = 0; editIndex < edits.size(); editIndex++)
+	{
+		const NodeEdit &edit = edits[editIndex];
+		if (edit.nodeIndex >= nodes.size())
+		{
+			string errorMessage = std::format(
+				"applyEdits failed, node not found"
+				", editIndex: {}"
+				", nodeIndex: {}"
+				", nodeNr: {}",
+				editIndex, edit.nodeIndex, nodes.size()
+			);
+			LOG_ERROR(errorMessage);
 
-        if (!resultToBeFreed
-        	|| !resultToBeFreed->nodesetval
-        	|| resultToBeFreed->nodesetval->nodeNr <= nodeIndex)
-        {
-        	string errorMessage = std::format("setAttribute failed, node not found"
-				", xPathExpression: {}"
-				", nodeNr: {}"
-				", nodeIndex: {}",
-				xPathExpression, resultToBeFreed && resultToBeFreed->nodesetval ? resultToBeFreed->nodesetval->nodeNr : -1,
-				nodeIndex);
-        	LOG_ERROR(errorMessage);
+			throw runtime_error(errorMessage);
+		}
+		const xmlNodePtr node = nodes[edit.nodeIndex];
+		const bool applies = edit.type == NodeEdit::Type::Remove ? node->type != XML_DOCUMENT_NODE && node->type != XML_NAMESPACE_DECL
+																 : node->type == XML_ELEMENT_NODE;
+		if (!applies)
+		{
+			string errorMessage = std::format(
+				"applyEdits failed, the edit does not apply to the node type"
+				", editIndex: {}"
+				", nodeIndex: {}"
+				", nodeType: {}",
+				editIndex, edit.nodeIndex, static_cast<int>(node->type)
+			);
+			LOG_ERROR(errorMessage);
 
-            throw std::runtime_error(errorMessage);
-        }
+			throw runtime_error(errorMessage);
+		}
+		if (edit.type != NodeEdit::Type::SetAttribute && edit.type != NodeEdit::Type::RemoveAttribute)
+			onlyAttributes = false;
+	}
 
-        xmlNodePtr node = resultToBeFreed->nodesetval->nodeTab[nodeIndex];
-        if (!node)
-        {
-			const string errorMessage = std::format("setAttribute failed, node not found"
-				", xPathExpression: {}",
-				xPathExpression);
-        	LOG_ERROR(errorMessage);
+	if (onlyAttributes)
+	{
+		for (const NodeEdit &edit : edits)
+			dropAttributeIndexes(edit.name);
+	}
+	else
+		dropAttributeIndexes();
 
-        	throw std::runtime_error(errorMessage);
-        }
+	return editNodes(
+		[&](vector<xmlNodePtr> &unlinkedNodes)
+		{
+			for (const NodeEdit &edit : edits)
+				applyEdit(nodes[edit.nodeIndex], edit.type, edit.name, edit.value, unlinkedNodes);
 
-        // Set (create or replace) the attribute.
-        // xmlSetProp returns xmlAttrPtr (nullptr on error).
-        xmlAttrPtr a = xmlSetProp(node, BAD_CAST attributeName.c_str(), BAD_CAST attributeValue.c_str());
+			return edits.size();
+		}
+	);
+}
 
-        if (!a)
-        {
-        	string errorMessage = std::format("setAttribute failed"
-				", xPathExpression: {}"
-				", attributeName: {}",
-				xPathExpression, attributeName);
-        	LOG_ERROR(errorMessage);
+XMLWrapper::ValueError XMLWrapper::parseValue(string_view text, int64_t &value) { return parseText(text, value); }
 
-            throw std::runtime_error(errorMessage);
-        }
+XMLWrapper::ValueError XMLWrapper::parseValue(string_view text, double &value) { return parseText(text, value); }
 
-        return true;
-    }
-    catch (const std::exception& e)
-    {
-        LOG_ERROR("setAttribute failed"
-        	", xPathExpression: {}"
-        	", exception: {}",
-        	xPathExpression, e.what());
+XMLWrapper::ValueError XMLWrapper::parseValue(string_view text, bool &value) { return parseText(text, value); }
 
-        throw;
-    }
+XMLWrapper::ValueError XMLWrapper::parseValue(string_view text, TimePoint &value) { return parseText(text, value); }
+
+XMLWrapper::ValueError XMLWrapper::parseValue(string_view text, string &value)
+{
+	value.assign(text);
+
+	return ValueError::None;
 }
 
-vector<string> XMLWrapper::asAttributesList(const string& xPathExpression, const string& attributeName, xmlNodePtr startingNode, bool emptyOnError) const
+void XMLWrapper::parseBindingFile(const string &pathName, const XMLBindingTarget &target, const XMLParserOptions &parserOptions)
 {
 	try
 	{
-		xmlXPathObjectPtr resultToBeFreed = xPath(xPathExpression, startingNode, emptyOnError);
-		struct XpGuard {
-			xmlXPathObjectPtr _resultToBeFreed;
-			~XpGuard()
-			{
-				if(_resultToBeFreed)
-					xmlXPathFreeObject(_resultToBeFreed);
-			}
-		} guard{resultToBeFreed};
-
-		vector<string> attributes;
-		for (int nodeIndex = 0; nodeIndex < resultToBeFreed->nodesetval->nodeNr; nodeIndex++)
+		ifstream in(pathName, ios::binary);
+		if (!in)
 		{
-			xmlNodePtr node = resultToBeFreed->nodesetval->nodeTab[nodeIndex];
-			attributes.push_back(asAttribute(node, attributeName));
+			string errorMessage = std::format(
+				"open failed"
+				", pathName: {}",
+				pathName
+			);
+			LOG_ERROR(errorMessage);
+
+			throw runtime_error(errorMessage);
 		}
 
-		return attributes;
+		parseBinding(
+			target, parserOptions, pathName,
+			[&in](ChunkParser &chunkParser)
+			{
+				vector<char> buffer(256 * 1024);
+				while (in.read(buffer.data(), static_cast<streamsize>(buffer.size())) || in.gcount() > 0)
+					if (!chunkParser.parse(string_view(buffer.data(), in.gcount())))
+						break;
+			}
+		);
 	}
 	catch (const exception &e)
 	{
-		if (emptyOnError)
-			return {};
-
 		LOG_ERROR(
-			"asAttributesList failed"
-			", xPathExpression: {}"
+			"bindFile failed"
+			", pathName: {}"
+			", recordPath: {}"
 			", exception: {}",
-			xPathExpression, e.what()
+			pathName, target.recordPath, e.what()
 		);
 
 		throw;
 	}
 }
 
-vector<string> XMLWrapper::asTextList(const string& xPathExpression, xmlNodePtr startingNode, bool emptyOnError) const
+void XMLWrapper::parseBindingMemory(string_view xml, const XMLBindingTarget &target, const XMLParserOptions &parserOptions)
 {
 	try
 	{
-		xmlXPathObjectPtr resultToBeFreed = xPath(xPathExpression, startingNode, emptyOnError);
-		struct XpGuard {
-			xmlXPathObjectPtr _resultToBeFreed;
-			~XpGuard()
+		parseBinding(
+			target, parserOptions, "memory",
+			[xml](ChunkParser &chunkParser)
 			{
-				if(_resultToBeFreed)
-					xmlXPathFreeObject(_resultToBeFreed);
+				// xmlParseChunk takes an int size
+				constexpr size_t chunkSize = 4 * 1024 * 1024;
+				for (size_t offset = 0; offset < xml.size(); offset += chunkSize)
+					if (!chunkParser.parse(xml.substr(offset, chunkSize)))
+						break;
 			}
-		} guard{resultToBeFreed};
-
-		vector<string> textList;
-		for (int nodeIndex = 0; nodeIndex < resultToBeFreed->nodesetval->nodeNr; nodeIndex++)
-		{
-			xmlNodePtr node = resultToBeFreed->nodesetval->nodeTab[nodeIndex];
-			if (node->type == XML_ELEMENT_NODE)
-				textList.push_back((char *)(node->children->content));
-			else // XML_TEXT_NODE
-				textList.push_back((char *)(node->content));
-		}
-
-		return textList;
+		);
 	}
 	catch (const exception &e)
 	{
-		if (emptyOnError)
-			return {};
-
 		LOG_ERROR(
-			"asAttributes failed"
-			", xPathExpression: {}"
+			"bindMemory failed"
+			", recordPath: {}"
 			", exception: {}",
-			xPathExpression, e.what()
+			target.recordPath, e.what()
 		);
 
 		throw;
 	}
 }
 
-string XMLWrapper::asText(const string& xPathExpression, xmlNodePtr startingNode, bool emptyOnError) const
+template <typename T> XMLWrapper::ValueError XMLWrapper::parseNode(xmlNodePtr node, T &value)
 {
-	try
+	// the string value, as the XPath number(): read in place when it is a single text node, otherwise (an attribute with
+	// entity references, an element with comments, child elements or more text nodes) its text and CDATA are concatenated
+	const bool singleText = node->children != nullptr && node->children->next == nullptr &&
+							(node->children->type == XML_TEXT_NODE || node->children->type == XML_CDATA_SECTION_NODE);
+	if ((node->type == XML_ATTRIBUTE_NODE || node->type == XML_ELEMENT_NODE) && !singleText && node->children != nullptr)
 	{
-		xmlXPathObjectPtr resultToBeFreed = xPath(xPathExpression, startingNode, emptyOnError);
-		struct XpGuard {
-			xmlXPathObjectPtr _resultToBeFreed;
-			~XpGuard()
-			{
-				if(_resultToBeFreed)
-					xmlXPathFreeObject(_resultToBeFreed);
-			}
-		} guard{resultToBeFreed};
+		xmlChar *content = xmlNodeGetContent(node);
+		ValueError error = parseText(content == nullptr ? ""sv : string_view(reinterpret_cast<const char *>(content)), value);
+		xmlFree(content);
+
+		return error;
+	}
+
+	return parseText(nodeTextView(node), value);
+}
+
+template <typename T> XMLWrapper::TypedValue<T> XMLWrapper::typedValue(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	TypedValue<T> typedValue;
+
+	xmlNodePtr node = tryFirstNode(xPathExpression, startingNode);
+	if (node == nullptr)
+		typedValue.error = ValueError::NotFound;
+	else
+		typedValue.error = parseNode(node, typedValue.value);
+
+	return typedValue;
+}
+
+template <typename T> XMLWrapper::TypedValue<T> XMLWrapper::typedValue(xmlNodePtr node, const string &attributeName)
+{
+	TypedValue<T> typedValue;
+	typedValue.error = ValueError::NotFound;
+
+	if (node == nullptr || node->type != XML_ELEMENT_NODE)
+		return typedValue;
 
-		string text;
-		if (resultToBeFreed->type == XPATH_STRING)
-			text = reinterpret_cast<char *>(resultToBeFreed->stringval);
-		else if (resultToBeFreed->type == XPATH_NODESET && resultToBeFreed->nodesetval->nodeNr > 0)
+	// same matching as xmlGetProp: by name, independently of the namespace
+	for (xmlAttrPtr attribute = node->properties; attribute != nullptr; attribute = attribute->next)
+	{
+		if (xmlStrEqual(attribute->name, BAD_CAST attributeName.c_str()))
 		{
-			if (resultToBeFreed->nodesetval->nodeTab[0]->type == XML_TEXT_NODE)
-				text = reinterpret_cast<char *>(resultToBeFreed->nodesetval->nodeTab[0]->content);
-			else if (resultToBeFreed->nodesetval->nodeTab[0]->type == XML_ATTRIBUTE_NODE)
-				text = reinterpret_cast<char *>(resultToBeFreed->nodesetval->nodeTab[0]->children->content);
+			typedValue.error = parseNode(reinterpret_cast<xmlNodePtr>(attribute), typedValue.value);
+			break;
 		}
-		else
-		{
-			string errorMessage = std::format(
-				"xPathExpression was found but how to retrieve the text?"
-				", xPathExpression: {}"
-				", type: {}",
-				xPathExpression, static_cast<int>(resultToBeFreed->type)
-			);
-			LOG_ERROR(errorMessage);
+	}
 
-			throw runtime_error(errorMessage);
-		}
+	return typedValue;
+}
 
-		return text;
-	}
-	catch (const exception &e)
+template <typename T>
+XMLWrapper::TypedValue<vector<T>> XMLWrapper::typedValueList(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	TypedValue<vector<T>> typedValues;
+
+	const XPathResult result(tryXPath(xPathExpression, startingNode));
+	if (result.empty())
 	{
-		if (emptyOnError)
-			return "";
+		typedValues.error = ValueError::NotFound;
 
-		LOG_ERROR(
-			"asText failed"
-			", xPathExpression: {}"
-			", exception: {}",
-			xPathExpression, e.what()
-		);
+		return typedValues;
+	}
 
-		throw;
+	typedValues.value.reserve(result.size());
+	for (xmlNodePtr node : result)
+	{
+		T value{};
+		if (typedValues.error = parseNode(node, value); typedValues.error != ValueError::None)
+			break;
+		typedValues.value.push_back(value);
 	}
+
+	return typedValues;
 }
 
-void XMLWrapper::setElementText(const string& xPathExpression, xmlNodePtr startingNode, const std::string& newText) const
+XMLWrapper::TypedValue<int64_t> XMLWrapper::asInt64(const string &xPathExpression, xmlNodePtr startingNode) const
 {
-	try
-	{
-		xmlXPathObjectPtr resultToBeFreed = xPath(xPathExpression, startingNode, false);
-		struct XpGuard {
-			xmlXPathObjectPtr _resultToBeFreed;
-			~XpGuard()
-			{
-				if(_resultToBeFreed)
-					xmlXPathFreeObject(_resultToBeFreed);
-			}
-		} guard{resultToBeFreed};
+	return typedValue<int64_t>(xPathExpression, startingNode);
+}
 
-		if (!resultToBeFreed
-			|| !resultToBeFreed->nodesetval
-			|| resultToBeFreed->nodesetval->nodeNr <= 0)
-		{
-			string errorMessage = std::format("setElementText failed, node not found"
-				", xPathExpression: {}"
-				", nodeNr: {}",
-				xPathExpression, resultToBeFreed && resultToBeFreed->nodesetval ? resultToBeFreed->nodesetval->nodeNr : -1);
-			LOG_ERROR(errorMessage);
+XMLWrapper::TypedValue<double> XMLWrapper::asDouble(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	return typedValue<double>(xPathExpression, startingNode);
+}
 
-			throw std::runtime_error(errorMessage);
-		}
+XMLWrapper::TypedValue<bool> XMLWrapper::asBool(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	return typedValue<bool>(xPathExpression, startingNode);
+}
 
-		xmlNodePtr node = resultToBeFreed->nodesetval->nodeTab[0];
-		if (!node || node->type != XML_ELEMENT_NODE)
-		{
-			const string errorMessage = std::format("setElementText failed, element node not found"
-				", xPathExpression: {}",
-				xPathExpression);
-			LOG_ERROR(errorMessage);
+XMLWrapper::TypedValue<XMLWrapper::TimePoint> XMLWrapper::asTimePoint(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	return typedValue<TimePoint>(xPathExpression, startingNode);
+}
 
-			throw std::runtime_error(errorMessage);
-		}
+XMLWrapper::TypedValue<int64_t> XMLWrapper::asInt64(xmlNodePtr node, const string &attributeName) { return typedValue<int64_t>(node, attributeName); }
 
-		xmlNodeSetContent(node, BAD_CAST newText.c_str());
-	}
-	catch (const exception &e)
-	{
-		LOG_ERROR(
-			"setElementText failed"
-			", xPathExpression: {}"
-			", exception: {}",
-			xPathExpression, e.what()
-		);
+XMLWrapper::TypedValue<double> XMLWrapper::asDouble(xmlNodePtr node, const string &attributeName) { return typedValue<double>(node, attributeName); }
 
-		throw;
-	}
+XMLWrapper::TypedValue<bool> XMLWrapper::asBool(xmlNodePtr node, const string &attributeName) { return typedValue<bool>(node, attributeName); }
+
+XMLWrapper::TypedValue<XMLWrapper::TimePoint> XMLWrapper::asTimePoint(xmlNodePtr node, const string &attributeName)
+{
+	return typedValue<TimePoint>(node, attributeName);
+}
+
+XMLWrapper::TypedValue<vector<int64_t>> XMLWrapper::asInt64List(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	return typedValueList<int64_t>(xPathExpression, startingNode);
+}
+
+XMLWrapper::TypedValue<vector<double>> XMLWrapper::asDoubleList(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	return typedValueList<double>(xPathExpression, startingNode);
+}
+
+XMLWrapper::TypedValue<vector<bool>> XMLWrapper::asBoolList(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	return typedValueList<bool>(xPathExpression, startingNode);
+}
+
+XMLWrapper::TypedValue<vector<XMLWrapper::TimePoint>> XMLWrapper::asTimePointList(const string &xPathExpression, xmlNodePtr startingNode) const
+{
+	return typedValueList<TimePoint>(xPathExpression, startingNode);
 }
 
+bool XMLWrapper::exists(const string &xPathExpression, xmlNodePtr startingNode) const { return tryFirstNode(xPathExpression, startingNode) != nullptr; }
+
 bool XMLWrapper::tagExist(const string& xPathExpression, xmlNodePtr startingNode, bool emptyOnError) const
 {
+	if (exists(xPathExpression, startingNode))
+		return true;
+	if (emptyOnError)
+		return false;
+
 	try
 	{
-		bool tagExist = false;
-
-		xmlXPathObjectPtr resultToBeFreed = xPath(xPathExpression, startingNode, emptyOnError);
-		struct XpGuard {
-			xmlXPathObjectPtr _resultToBeFreed;
-			~XpGuard()
-			{
-				if(_resultToBeFreed)
-					xmlXPathFreeObject(_resultToBeFreed);
-			}
-		} guard{resultToBeFreed};
-		if (resultToBeFreed->type == XPATH_NODESET && resultToBeFreed->nodesetval->nodeNr > 0)
-			tagExist = true;
-
-		return tagExist;
+		throwXPathError(xPathExpression, startingNode);
 	}
 	catch (const exception &e)
 	{
-		if (emptyOnError)
-			return false;
-
 		LOG_ERROR(
 			"tagExist failed"
 			", xPathExpression: {}"
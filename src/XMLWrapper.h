@@ -6,7 +6,21 @@
 #include "spdlog/spdlog.h"
 
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
+#include <libxml/xmlsave.h>
 #include <libxml/xpath.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 // using namespace std;
@@ -19,27 +33,466 @@ struct XMLReadMemory final : public std::runtime_error
 	[[nodiscard]] virtual std::string_view type() const noexcept { return "XMLReadMemory"; }
 };
 
+// libxml2 parser options used by the load/stream methods, the default (all false) is the libxml2 default behaviour
+struct XMLParserOptions
+{
+	bool noBlanks = false;			 // XML_PARSE_NOBLANKS: whitespace-only text nodes are dropped
+	bool compact = false;			 // XML_PARSE_COMPACT: short text nodes are stored inside the node, saving an allocation
+	bool noDict = false;			 // XML_PARSE_NODICT: names are not interned in the document dictionary
+	bool huge = false;				 // XML_PARSE_HUGE: no hardcoded limit on depth and text size
+	bool noNetwork = false;			 // XML_PARSE_NONET: no network access while parsing (i.e. external DTD)
+	bool noCData = false;			 // XML_PARSE_NOCDATA: CDATA sections are merged as text nodes
+	bool substituteEntities = false; // XML_PARSE_NOENT
+	bool recover = false;			 // XML_PARSE_RECOVER: a document not well formed is loaded anyway, as far as possible
+	int otherOptions = 0;			 // any other xmlParserOption, or-ed as it is
+
+	[[nodiscard]] int flags() const;
+
+	// tuned for documents that are loaded to be only read: no blank nodes, compact text nodes, CDATA as text,
+	// no network and no size limits (big feeds), names interned in the dictionary
+	static XMLParserOptions fastReadOnly();
+};
+
+// shared by the XMLWrapper instances loading, one after the other or concurrently, documents of the same schema
+// (i.e. an importer loading thousands of feeds): parser contexts and XPath contexts are reused instead of being
+// created for every load, and the tag/attribute names of the first document loaded are interned in a dictionary
+// that every following document looks up before allocating its own strings.
+// The shared dictionary is never modified once learned (libxml2 dictionaries are not thread safe),
+// every document gets its own small sub-dictionary for the names not found there
+class XMLParserPool
+{
+  public:
+	struct Stats
+	{
+		uint64_t parserContextsCreated = 0;
+		uint64_t parserContextsReused = 0;
+		uint64_t xpathContextsCreated = 0;
+		uint64_t xpathContextsReused = 0;
+		size_t dictionaryNames = 0;
+	};
+
+	// at most maxIdleContexts parser contexts and XPath contexts are kept for reuse
+	explicit XMLParserPool(size_t maxIdleContexts = 16);
+	~XMLParserPool();
+	XMLParserPool(const XMLParserPool &) = delete;
+	XMLParserPool &operator=(const XMLParserPool &) = delete;
+
+	[[nodiscard]] Stats stats() const;
+
+  private:
+	friend class XMLWrapper;
+
+	mutable std::mutex _mutex;
+	size_t _maxIdleContexts;
+	xmlDictPtr _dict = nullptr;
+	std::vector<xmlParserCtxtPtr> _parserContexts;
+	std::vector<xmlXPathContextPtr> _xpathContexts;
+	Stats _stats;
+
+	// new dictionary for a document, owned by the caller
+	[[nodiscard]] xmlDictPtr newDictionary() const;
+	// the names of the document become the shared dictionary, if it was not already learned
+	void learnNames(xmlDocPtr doc);
+	xmlParserCtxtPtr acquireParserContext();
+	void releaseParserContext(xmlParserCtxtPtr parserCtxt);
+	xmlXPathContextPtr acquireXPathContext(xmlDocPtr doc);
+	void releaseXPathContext(xmlXPathContextPtr xpathCtx);
+};
+
+class XMLWrapper;
+
+// parsed documents persisted in a directory, one file per url, so that after a restart a document is rehydrated
+// (XMLWrapper::loadFromCache) instead of being downloaded and parsed again. The file is a compact binary image of the tree
+// (names interned, offsets instead of pointers) read through mmap, together with the ETag and Last-Modified of the download.
+// Documents with a DTD are not cached
+class XMLDocumentCache
+{
+  public:
+	// the directory is created if missing
+	explicit XMLDocumentCache(std::string directory);
+	XMLDocumentCache(const XMLDocumentCache &) = delete;
+	XMLDocumentCache &operator=(const XMLDocumentCache &) = delete;
+
+	// the document of xmlWrapper, with its ETag and Last-Modified, replaces the one cached for url.
+	// false if the document cannot be cached or the file cannot be written (the cache is only an optimization, nothing is thrown)
+	bool store(const std::string &url, const XMLWrapper &xmlWrapper) const;
+	void remove(const std::string &url) const;
+
+  private:
+	friend class XMLWrapper;
+
+	std::string _directory;
+
+	[[nodiscard]] std::string pathName(const std::string &url) const;
+	// nullptr if url is not cached or its file is not readable, dict is owned by the returned document
+	xmlDocPtr load(const std::string &url, std::string &eTag, std::string &lastModified, xmlDictPtr dict) const;
+};
+
+// bump allocator holding the documents of an XMLWrapper in arena mode (see XMLWrapper::setArenaAllocation)
+class XMLDocumentArena;
+
+// field of an XMLBinding: path, relative to the record element, mapped to a member of Record.
+// The path is a sequence of element names ending optionally with an attribute ("title", "@id", "media/@url"),
+// "." is the record element itself. An element gives the text directly inside it.
+// Member types: std::string, bool, integral and floating point types, XMLWrapper::TimePoint
+template <typename Record, typename Member> struct XMLField
+{
+	std::string_view path;
+	Member Record::*member;
+};
+
+// compile-time description of a record type, for XMLWrapper::bindFile/bindMemory:
+//	struct Entry { std::string id; std::string title; int64_t views = 0; };
+//	constexpr XMLBinding entryBinding{"/feed/entry", XMLField{"@id", &Entry::id}, XMLField{"title", &Entry::title},
+//		XMLField{"stats/@views", &Entry::views}};
+template <typename Record, typename... Members> struct XMLBinding
+{
+	std::string_view recordPath; // absolute path of elements, as in streamFile
+	std::tuple<XMLField<Record, Members>...> fields;
+
+	constexpr XMLBinding(std::string_view recordPath, XMLField<Record, Members>... fields) : recordPath(recordPath), fields(fields...) {}
+};
+
+// type-erased side of an XMLBinding, driven by the SAX2 parser of XMLWrapper::bindFile/bindMemory
+struct XMLBindingTarget
+{
+	std::string_view recordPath;
+	std::vector<std::string_view> fieldPaths;
+	// a record starts, the following values belong to it
+	std::function<void()> newRecord;
+	// return false if value is malformed for the type of the field
+	std::function<bool(size_t fieldIndex, std::string_view value)> assign;
+};
+
 class XMLWrapper
 {
 
   public:
+	// XPath expression compiled once by libxml2 and shared, through the process-wide cache, by every XMLWrapper
+	struct CompiledXPath
+	{
+		// child, attribute and text() steps with an optional position, i.e. media/content/@url, ./price/text(), /feed/entry[2]
+		struct SimplePath;
+
+		std::string expression;
+		xmlXPathCompExprPtr compExpr = nullptr;
+		// not null if the expression is a simple path, evaluated walking the tree instead of through the XPath engine
+		std::unique_ptr<const SimplePath> simplePath;
+		// metrics of the expression, updated only if enabled (enableMetrics)
+		mutable std::atomic<uint64_t> evaluations = 0;
+		mutable std::atomic<uint64_t> misses = 0;
+		mutable std::atomic<uint64_t> nanoseconds = 0;
+
+		CompiledXPath(std::string expression, xmlXPathCompExprPtr compExpr);
+		~CompiledXPath();
+		CompiledXPath(const CompiledXPath &) = delete;
+		CompiledXPath &operator=(const CompiledXPath &) = delete;
+	};
+	using PreparedXPath = std::shared_ptr<const CompiledXPath>;
+
+	// owns the result of an XPath evaluation (freed by the destructor) and iterates on the nodes of its node set:
+	//	for (xmlNodePtr node : xmlWrapper.select("/feed/entry"))
+	// The nodes are valid as long as the document is loaded and not modified
+	class XPathResult
+	{
+	  public:
+		XPathResult() = default;
+		explicit XPathResult(xmlXPathObjectPtr result);
+		~XPathResult();
+		XPathResult(const XPathResult &) = delete;
+		XPathResult &operator=(const XPathResult &) = delete;
+		XPathResult(XPathResult &&other) noexcept;
+		XPathResult &operator=(XPathResult &&other) noexcept;
+
+		[[nodiscard]] size_t size() const;
+		[[nodiscard]] bool empty() const { return size() == 0; }
+		xmlNodePtr operator[](size_t index) const { return begin()[index]; }
+		[[nodiscard]] xmlNodePtr *begin() const;
+		[[nodiscard]] xmlNodePtr *end() const;
+
+		[[nodiscard]] xmlXPathObjectPtr get() const { return _result; }
+		// the ownership passes to the caller, that has to free it with xmlXPathFreeObject
+		xmlXPathObjectPtr release();
+
+	  private:
+		xmlXPathObjectPtr _result = nullptr;
+	};
+
+	struct XPathCacheStats
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		size_t size = 0;
+		size_t capacity = 0;
+	};
+
+	// the loaders detect a compressed payload by its magic bytes and decompress it while parsing,
+	// saveXMLFile compresses while serializing
+	enum class Compression
+	{
+		None,
+		Gzip,
+		Zstd,
+		Xz
+	};
+
+	// what loadXML does with the downloaded payload once it is parsed
+	enum class SourceRetention
+	{
+		Retain,	   // kept in memory
+		Discard,   // freed
+		MappedFile // written to an unlinked temporary file and mapped read-only, so it does not weigh on the heap
+	};
+
+	// error of the typed accessors (asInt64, asDouble, asBool, asTimePoint)
+	enum class ValueError
+	{
+		None,
+		NotFound,  // no node selected, or invalid expression
+		Malformed, // the text is not a value of the type
+		OutOfRange // the value does not fit the type
+	};
+
+	template <typename T> struct TypedValue
+	{
+		T value{};
+		ValueError error = ValueError::None;
+
+		explicit operator bool() const { return error == ValueError::None; }
+	};
+
+	using TimePoint = std::chrono::system_clock::time_point;
+
+	// edit of a batch applied by applyEdits
+	struct NodeEdit
+	{
+		enum class Type
+		{
+			SetAttribute,	 // attribute name set to value
+			RemoveAttribute, // attribute name removed
+			SetText,		 // value replaces the content of the element, as setElementText does
+			AddChild,		 // child element name appended, with text value if not empty
+			Remove			 // the node is unlinked from the tree and freed
+		};
+
+		Type type;
+		size_t nodeIndex; // index of the node in the node set the edits are applied to
+		std::string name;
+		std::string value;
+	};
+
+	// upper bounds, in microseconds, of the buckets of the latency histograms, a last bucket counts the slower operations
+	static constexpr std::array<uint64_t, 14> latencyBucketBounds = {10,	  50,	  100,	   250,		500,	   1'000,	  2'500,
+																	  5'000, 10'000, 50'000, 100'000, 500'000, 1'000'000, 10'000'000};
+
+	struct LatencyHistogram
+	{
+		std::array<uint64_t, latencyBucketBounds.size() + 1> buckets{}; // not cumulative
+		uint64_t count = 0;
+		double seconds = 0;
+	};
+
+	struct XPathExpressionMetrics
+	{
+		std::string expression;
+		uint64_t evaluations = 0;
+		uint64_t misses = 0;
+		double seconds = 0;
+	};
+
+	// process-wide metrics, see enableMetrics
+	struct Metrics
+	{
+		LatencyHistogram download;		// loadXML, refresh, loadXMLIncremental (its parsing overlaps), XMLFeedLoader
+		LatencyHistogram parse;			// parsing of the loaders (xmlReadMemory, xmlReadFile, push parser)
+		LatencyHistogram xPath;			// every XPath evaluation
+		LatencyHistogram serialization; // asString, writeTo, saveXMLFile
+		uint64_t downloadedBytes = 0;
+		uint64_t parsedBytes = 0;
+		uint64_t parsedNodes = 0;
+		uint64_t serializedBytes = 0;
+		uint64_t xPathMisses = 0;
+		uint64_t selectedNodes = 0;
+		// the expressions in the XPath cache evaluated at least once (an evicted expression loses its metrics)
+		std::vector<XPathExpressionMetrics> expressions;
+	};
+
+	// result of extract: values[fieldIndex][recordIndex], a field not found in a record is left empty
+	struct Columns
+	{
+		std::vector<std::string> fieldNames;
+		std::vector<std::vector<std::string>> values;
+		size_t records = 0;
+	};
+
 	XMLWrapper();
+	// the documents are parsed, and their XPath contexts created, through the pool
+	explicit XMLWrapper(std::shared_ptr<XMLParserPool> parserPool);
 	~XMLWrapper();
+	// a moved from XMLWrapper is left without document, a move must not run concurrently with other calls on the two instances
+	XMLWrapper(XMLWrapper &&other) noexcept;
+	XMLWrapper &operator=(XMLWrapper &&other) noexcept;
+	XMLWrapper(const XMLWrapper &) = delete;
+	XMLWrapper &operator=(const XMLWrapper &) = delete;
+
+	// installs, process wide through xmlMemSetup, the libxml2 allocation hooks needed by setArenaAllocation.
+	// It has to be called once at startup, before any other libxml2/XMLWrapper call, since every block allocated
+	// by libxml2 from then on carries a 16 bytes header: it throws if an XMLWrapper, XMLParserPool or XMLFeedLoader was
+	// already created (libxml2 used directly by the application cannot be detected)
+	static void enableArenaAllocation();
+	// the documents loaded from now on are allocated in an arena owned by this XMLWrapper: parsing (and the mutations)
+	// bump-allocates and freeing the document releases the arena as a whole, without walking the tree.
+	// The current document, if any, is freed. The parser contexts and the dictionary of an XMLParserPool are not used in arena mode
+	void setArenaAllocation(bool arenaAllocation);
+	// the documents downloaded by loadXML and refresh are stored in the cache, and loadXML of a cached url rehydrates it and
+	// downloads it again only if the server does not answer 304 to the conditional GET (see refresh): if the download fails the
+	// rehydrated document is kept and the error is only logged.
+	// A rehydrated document has no source (sourceXML), it was parsed with the XMLParserOptions of the load that stored it
+	void setDocumentCache(std::shared_ptr<XMLDocumentCache> documentCache);
+	// the document cached for url, with its ETag and Last-Modified, without any network access: false if not cached
+	bool loadFromCache(const std::string &url, const std::vector<std::pair<std::string, std::string>> &nameServices);
 
 	void loadXML(
 		const std::string &url, int16_t timeoutInSeconds, const std::string &basicAuthenticationUser, const std::string &basicAuthenticationPassword,
 		int16_t maxRetryNumber, int16_t secondsToWaitBeforeToRetry,
-		const std::vector<std::pair<std::string, std::string>> &nameServices
+		const std::vector<std::pair<std::string, std::string>> &nameServices, SourceRetention sourceRetention = SourceRetention::Retain,
+		const XMLParserOptions &parserOptions = {}
+	);
+	// the document is parsed by a push parser while it is downloaded: every chunk received from the network is passed to
+	// xmlParseChunk, so parsing overlaps the transfer and the whole payload is never buffered (sourceXML() is left empty).
+	// The download is retried only in case of network/HTTP errors, not if the document is not well formed
+	void loadXMLIncremental(
+		const std::string &url, int16_t timeoutInSeconds, const std::string &basicAuthenticationUser, const std::string &basicAuthenticationPassword,
+		int16_t maxRetryNumber, int16_t secondsToWaitBeforeToRetry, const std::vector<std::pair<std::string, std::string>> &nameServices,
+		const XMLParserOptions &parserOptions = {}
+	);
+	// conditional GET of a document previously loaded by loadXML/refresh: If-None-Match/If-Modified-Since are sent using the
+	// ETag/Last-Modified of the previous response and, in case of 304, the current document is kept untouched and false is returned.
+	// If there is nothing to validate (different url, no document, no validators) it behaves like loadXML. Return true if the document changed
+	bool refresh(
+		const std::string &url, int16_t timeoutInSeconds, const std::string &basicAuthenticationUser, const std::string &basicAuthenticationPassword,
+		int16_t maxRetryNumber, int16_t secondsToWaitBeforeToRetry,
+		const std::vector<std::pair<std::string, std::string>> &nameServices, SourceRetention sourceRetention = SourceRetention::Retain,
+		const XMLParserOptions &parserOptions = {}
+	);
+	// payload of the last loadXML, empty if it was discarded or the document was loaded by other means
+	[[nodiscard]] std::string_view sourceXML() const;
+	// the document is parsed from bytes already available locally, sourceXML() and _eTag are left empty
+	void loadFromFile(
+		const std::string &pathName, const std::vector<std::pair<std::string, std::string>> &nameServices, const XMLParserOptions &parserOptions = {}
+	);
+	void loadFromMemory(
+		std::string_view xml, const std::vector<std::pair<std::string, std::string>> &nameServices, const XMLParserOptions &parserOptions = {}
 	);
+	void loadFromFd(int fd, const std::vector<std::pair<std::string, std::string>> &nameServices, const XMLParserOptions &parserOptions = {});
+
+	// streaming mode: the document is walked with an xmlTextReader and every element matching recordPath (absolute path of elements,
+	// i.e. /feed/entry) is passed to onRecord as a small XMLWrapper containing only that subtree (the record element is its root).
+	// The record is freed when onRecord returns, so the memory is bounded by the largest record. Return the number of records
+	static size_t streamFile(
+		const std::string &pathName, const std::string &recordPath, const std::vector<std::pair<std::string, std::string>> &nameServices,
+		const std::function<void(XMLWrapper &record)> &onRecord, const XMLParserOptions &parserOptions = {}
+	);
+	static size_t streamMemory(
+		std::string_view xml, const std::string &recordPath, const std::vector<std::pair<std::string, std::string>> &nameServices,
+		const std::function<void(XMLWrapper &record)> &onRecord, const XMLParserOptions &parserOptions = {}
+	);
+
 	[[nodiscard]] std::string asString(bool pretty = false) const;
-	void saveXMLFile(std::string pathName, bool pretty) const;
+	// the document is streamed through a small libxml2 output buffer, without building it in memory.
+	// With atomic it is written to a temporary file in the same directory, then renamed to pathName
+	void saveXMLFile(std::string pathName, bool pretty, bool atomic = false, Compression compression = Compression::None) const;
+	void writeTo(int fd, bool pretty = false) const;
+	void writeTo(const std::function<void(std::string_view chunk)> &write, bool pretty = false) const;
 
 	// [[nodiscard]] std::string toString() const;
 	static std::string nodeToString(xmlNodePtr node);
 
 	[[nodiscard]] xmlNodePtr asRootNode() const;
 
+	// the read methods (xPath, as*, try*, exists, tagExist) can be called concurrently by more threads on the same document,
+	// the mutations (setAttribute, setElementText and the batch ones) modify the tree and must not run concurrently with them
 	xmlXPathObjectPtr xPath(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr, bool noErrorLog = false) const;
+	xmlXPathObjectPtr xPath(const PreparedXPath &preparedXPath, xmlNodePtr startingNode = nullptr, bool noErrorLog = false) const;
+	// as xPath but the result is owned, and no match returns an empty result instead of throwing
+	[[nodiscard]] XPathResult select(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] XPathResult select(const PreparedXPath &preparedXPath, xmlNodePtr startingNode = nullptr) const;
+
+	// compiled expressions are kept in a bounded LRU cache keyed by the expression text
+	static PreparedXPath prepareXPath(const std::string &xPathExpression);
+	static XPathCacheStats xPathCacheStats();
+	static void setXPathCacheCapacity(size_t capacity);
+	static void clearXPathCache();
+
+	// metrics (atomic counters and latency histograms) are disabled by default, a disabled metric costs a relaxed atomic load
+	static void enableMetrics(bool enabled);
+	[[nodiscard]] static Metrics metrics();
+	// the metrics in the Prometheus text exposition format
+	[[nodiscard]] static std::string metricsText();
+	static void resetMetrics();
+
+	// non-throwing lookups: a missing node/attribute (or an invalid expression) returns std::nullopt/false
+	// without building any error message. The throwing methods below are implemented on top of them, the
+	// expression is evaluated again only on a miss, to build the exception
+	static std::optional<std::string> tryAttribute(xmlNodePtr node, const std::string &attributeName);
+	[[nodiscard]] std::optional<std::string>
+	tryAttribute(const std::string &xPathExpression, const std::string &attributeName, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] std::optional<std::vector<std::string>>
+	tryAttributesList(const std::string &xPathExpression, const std::string &attributeName, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] std::optional<std::string> tryText(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] std::optional<std::vector<std::string>> tryTextList(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] bool exists(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+
+	// zero-copy variants: the views point directly into the tree, so they are valid until the document is reloaded/freed
+	// or the node is modified (setAttribute/setElementText). An attribute whose value is split in more nodes (entity references)
+	// cannot be viewed and returns std::nullopt, tryAttribute has to be used in that case
+	static std::optional<std::string_view> tryAttributeView(xmlNodePtr node, const std::string &attributeName);
+	[[nodiscard]] std::optional<std::string_view>
+	tryAttributeView(const std::string &xPathExpression, const std::string &attributeName, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] std::optional<std::vector<std::string_view>>
+	tryAttributeViewsList(const std::string &xPathExpression, const std::string &attributeName, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] std::optional<std::string_view> tryTextView(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] std::optional<std::vector<std::string_view>>
+	tryTextViewList(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+
+	// typed accessors: the string value (as the XPath number()) of the first selected node or of the attribute of node is
+	// parsed with std::from_chars, ignoring the surrounding whitespaces. For an element it is all the text and CDATA inside it,
+	// comments and PIs skipped (<price><!-- eur --> 5 </price>, <price><amount>5</amount></price>), read in place when it
+	// is a single text node.
+	// Nothing is thrown, a missing node or a malformed value is reported by TypedValue::error.
+	// asBool accepts true/false/1/0, asTimePoint ISO 8601 (xs:dateTime, xs:date) and RFC 822 (RSS pubDate) dates.
+	// The list variants stop at the first malformed value
+	[[nodiscard]] TypedValue<int64_t> asInt64(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] TypedValue<double> asDouble(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] TypedValue<bool> asBool(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] TypedValue<TimePoint> asTimePoint(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+	static TypedValue<int64_t> asInt64(xmlNodePtr node, const std::string &attributeName);
+	static TypedValue<double> asDouble(xmlNodePtr node, const std::string &attributeName);
+	static TypedValue<bool> asBool(xmlNodePtr node, const std::string &attributeName);
+	static TypedValue<TimePoint> asTimePoint(xmlNodePtr node, const std::string &attributeName);
+	[[nodiscard]] TypedValue<std::vector<int64_t>> asInt64List(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] TypedValue<std::vector<double>> asDoubleList(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] TypedValue<std::vector<bool>> asBoolList(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+	[[nodiscard]] TypedValue<std::vector<TimePoint>>
+	asTimePointList(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+
+	// parsing of the typed accessors and of the bindings, the surrounding whitespaces are ignored (not for std::string)
+	static ValueError parseValue(std::string_view text, int64_t &value);
+	static ValueError parseValue(std::string_view text, double &value);
+	static ValueError parseValue(std::string_view text, bool &value);
+	static ValueError parseValue(std::string_view text, TimePoint &value);
+	static ValueError parseValue(std::string_view text, std::string &value);
+
+	// SAX2 binding: the records described by binding are parsed straight into a vector of Record, no DOM is built.
+	// Only the elements on the record path and on the field paths are looked at, the other subtrees are skipped.
+	// A field found more times in a record takes its first value, a malformed value leaves the member as initialized.
+	// The payload can be compressed, as for the loaders
+	template <typename Record, typename... Members>
+	static std::vector<Record>
+	bindFile(const std::string &pathName, const XMLBinding<Record, Members...> &binding, const XMLParserOptions &parserOptions = {});
+	template <typename Record, typename... Members>
+	static std::vector<Record> bindMemory(std::string_view xml, const XMLBinding<Record, Members...> &binding, const XMLParserOptions &parserOptions = {});
 
 	static std::string asAttribute(xmlNodePtr node, const std::string &attributeName, bool emptyOnError = false);
 
@@ -51,21 +504,251 @@ class XMLWrapper
 
 	std::vector<std::string> asAttributesList(const std::string &xPathExpression, const std::string &attributeName, xmlNodePtr startingNode = nullptr, bool emptyOnError = false) const;
 
+	// secondary index on the values of attributeName of the elements selected by elementXPathExpression (i.e. "//item", "id"),
+	// replacing a full scan like //item[@id='...'] with a hash lookup. It is built once, by buildAttributeIndex or by the
+	// first lookup, and kept until the document is reloaded. setAttribute updates it in place, it drops it when the element
+	// expression has a predicate (the attribute written may change the elements selected); setElementText drops it.
+	// Return the number of distinct values
+	size_t buildAttributeIndex(const std::string &elementXPathExpression, const std::string &attributeName) const;
+	// the first (in document order) element whose attribute is attributeValue, nullptr if none
+	[[nodiscard]] xmlNodePtr
+	findByAttribute(const std::string &elementXPathExpression, const std::string &attributeName, const std::string &attributeValue) const;
+	[[nodiscard]] std::vector<xmlNodePtr>
+	findAllByAttribute(const std::string &elementXPathExpression, const std::string &attributeName, const std::string &attributeValue) const;
+
 	std::string asText(const std::string &xPathExpression, xmlNodePtr startingNode, bool emptyOnError = false) const;
+	// batch extraction: for every node selected by recordXPathExpression, the text of every field (name, expression relative to
+	// the record node) is extracted as asText(..., true) would do. The records are split among threadsNumber threads
+	// (0 means hardware concurrency) and all the expressions are compiled only once
+	[[nodiscard]] Columns extract(
+		const std::string &recordXPathExpression, const std::vector<std::pair<std::string, std::string>> &fields, xmlNodePtr startingNode = nullptr,
+		size_t threadsNumber = 0
+	) const;
+
 	void setElementText(const std::string &xPathExpression, xmlNodePtr startingNode, const std::string &newText) const;
 
+	// batch mutations: the nodes are selected once and edited in a single pass, instead of an XPath evaluation for every
+	// setAttribute/setElementText. The nodes unlinked by the pass (removed, or replaced by SetText) are freed only at its end,
+	// so the rest of the node set stays valid during it. The attribute indexes involved are dropped.
+	// The *All methods edit every element selected (other nodes are skipped) and return the number of elements edited
+	size_t setAttributeAll(
+		const std::string &xPathExpression, const std::string &attributeName, const std::string &attributeValue, xmlNodePtr startingNode = nullptr
+	) const;
+	size_t setElementTextAll(const std::string &xPathExpression, const std::string &newText, xmlNodePtr startingNode = nullptr) const;
+	size_t addChildElementAll(
+		const std::string &xPathExpression, const std::string &childName, const std::string &childText = "", xmlNodePtr startingNode = nullptr
+	) const;
+	// return the number of nodes removed
+	size_t removeNodes(const std::string &xPathExpression, xmlNodePtr startingNode = nullptr) const;
+	// the edits refer by index to nodes already selected (i.e. by select). They are all validated (index, node type) before
+	// the first one is applied. The removed nodes are freed, so nodes must not be used afterwards. Return the number of edits applied
+	size_t applyEdits(const XPathResult &nodes, const std::vector<NodeEdit> &edits) const;
+
 	bool tagExist(const std::string &xPathExpression, xmlNodePtr startingNode, bool emptyOnError = false) const;
 
 	std::vector<std::string> asTextList(const std::string &xPathExpression, xmlNodePtr startingNode, bool emptyOnError = false) const;
 
 	static void logAttributes(xmlNodePtr node);
 
-	std::string _sourceXML;
 	std::string _eTag;
 
   private:
+	friend class XMLFeedLoader;
+	friend class XMLDocumentCache;
+
+	std::string _url;
+	std::string _lastModified;
+	std::string _sourceXML;
+	void *_sourceMapping = nullptr;
+	size_t _sourceMappingSize = 0;
 	xmlDocPtr _doc;
-	xmlXPathContextPtr _xpathCtx;
+	// XPath contexts not in use: an evaluation borrows one (or creates a new one) so that the read methods can be called concurrently
+	mutable std::mutex _xpathContextsMutex;
+	mutable std::vector<xmlXPathContextPtr> _xpathContexts;
+	std::vector<std::pair<std::string, std::string>> _nameServices;
+	std::shared_ptr<XMLParserPool> _parserPool;
+	std::unique_ptr<XMLDocumentArena> _arena;
+	std::shared_ptr<XMLDocumentCache> _documentCache;
+	// attribute value -> elements, keyed by (element XPath expression, attribute name)
+	using AttributeIndex = std::unordered_map<std::string, std::vector<xmlNodePtr>>;
+	mutable std::mutex _attributeIndexesMutex;
+	mutable std::map<std::pair<std::string, std::string>, AttributeIndex> _attributeIndexes;
 
 	void finish();
+	void downloadAndParse(
+		const std::string &url, int16_t timeoutInSeconds, const std::string &basicAuthenticationUser, const std::string &basicAuthenticationPassword,
+		const std::vector<std::pair<std::string, std::string>> &nameServices, const XMLParserOptions &parserOptions
+	);
+	void save(xmlSaveCtxtPtr saveCtxt, const std::string &destination) const;
+	void loadBody(
+		const std::string &url, std::string &&body, const std::string &eTag, const std::string &lastModified,
+		const std::vector<std::pair<std::string, std::string>> &nameServices, SourceRetention sourceRetention, const XMLParserOptions &parserOptions
+	);
+	void mapSource(const std::string &body);
+	void releaseSource();
+	void parseMemory(
+		std::string_view xml, const std::string &source, const std::vector<std::pair<std::string, std::string>> &nameServices,
+		const XMLParserOptions &parserOptions
+	);
+	void setDocument(
+		xmlDocPtr doc, const std::string &readFunction, const std::string &source, const std::vector<std::pair<std::string, std::string>> &nameServices
+	);
+	void createXPathContext(const std::string &source, const std::vector<std::pair<std::string, std::string>> &nameServices);
+	[[nodiscard]] xmlXPathContextPtr newXPathContext() const;
+	[[nodiscard]] xmlDictPtr newDictionary() const;
+	xmlXPathContextPtr acquireXPathContext() const;
+	void releaseXPathContext(xmlXPathContextPtr xpathCtx) const;
+
+	static size_t streamRecords(
+		xmlTextReaderPtr reader, const std::string &source, const std::string &recordPath,
+		const std::vector<std::pair<std::string, std::string>> &nameServices, const std::function<void(XMLWrapper &record)> &onRecord
+	);
+
+	template <typename Record, typename... Members>
+	static XMLBindingTarget bindingTarget(const XMLBinding<Record, Members...> &binding, std::vector<Record> &records);
+	template <typename T> static bool assignValue(std::string_view text, T &value);
+	static void parseBindingFile(const std::string &pathName, const XMLBindingTarget &target, const XMLParserOptions &parserOptions);
+	static void parseBindingMemory(std::string_view xml, const XMLBindingTarget &target, const XMLParserOptions &parserOptions);
+
+	static PreparedXPath compiledXPath(const std::string &xPathExpression);
+	// return nullptr if the document is not loaded or the node set is empty
+	xmlXPathObjectPtr evalXPath(const CompiledXPath &compiledXPath, xmlNodePtr startingNode) const;
+	xmlXPathObjectPtr tryXPath(const std::string &xPathExpression, xmlNodePtr startingNode) const;
+	// first node selected by the expression, nullptr if none: a simple path is walked without any allocation
+	xmlNodePtr tryFirstNode(const std::string &xPathExpression, xmlNodePtr startingNode) const;
+	xmlNodePtr tryFirstNode(const CompiledXPath &compiledXPath, xmlNodePtr startingNode) const;
+	// the error of a throwing method whose lookup selected nothing: the exception (and the log) of xPath
+	[[noreturn]] void throwXPathError(const std::string &xPathExpression, xmlNodePtr startingNode) const;
+	[[nodiscard]] std::optional<xmlNodePtr> firstSimpleNode(const CompiledXPath &compiledXPath, xmlNodePtr startingNode) const;
+
+	// _attributeIndexesMutex has to be locked
+	const AttributeIndex &attributeIndex(const std::string &elementXPathExpression, const std::string &attributeName) const;
+	void dropAttributeIndexes() const;
+	void dropAttributeIndexes(const std::string &attributeName) const;
+
+	// the nodes unlinked by the edit are appended to unlinkedNodes, return false if the edit does not apply to the node type
+	bool applyEdit(xmlNodePtr node, NodeEdit::Type type, const std::string &name, const std::string &value, std::vector<xmlNodePtr> &unlinkedNodes)
+		const;
+	// edit(unlinkedNodes) runs in the arena (if any) and the unlinked nodes are freed at its end
+	template <typename Edit> size_t editNodes(const Edit &edit) const;
+	size_t editAll(
+		const std::string &xPathExpression, xmlNodePtr startingNode, NodeEdit::Type type, const std::string &name, const std::string &value
+	) const;
+
+	template <typename T> TypedValue<T> typedValue(const std::string &xPathExpression, xmlNodePtr startingNode) const;
+	template <typename T> static TypedValue<T> typedValue(xmlNodePtr node, const std::string &attributeName);
+	template <typename T> TypedValue<std::vector<T>> typedValueList(const std::string &xPathExpression, xmlNodePtr startingNode) const;
+	template <typename T> static ValueError parseNode(xmlNodePtr node, T &value);
+
+	static std::string_view nodeTextView(xmlNodePtr node);
+	static std::string nodeText(xmlNodePtr node);
+	static std::string_view textViewOf(xmlNodePtr node);
+};
+
+// loads many feeds concurrently: the downloads (CurlWrapper::httpGet) run on maxConnections threads, the parsing on a separate
+// pool of parseThreads threads, and every feed is delivered to onLoaded as soon as it is parsed.
+// At most 2 * parseThreads downloaded payloads wait for a parse thread, then the downloads wait
+class XMLFeedLoader
+{
+  public:
+	struct Feed
+	{
+		std::string url;
+		int16_t timeoutInSeconds = 30;
+		std::string basicAuthenticationUser;
+		std::string basicAuthenticationPassword;
+		int16_t maxRetryNumber = 0;
+		int16_t secondsToWaitBeforeToRetry = 0;
+		std::vector<std::pair<std::string, std::string>> nameServices;
+		XMLWrapper::SourceRetention sourceRetention = XMLWrapper::SourceRetention::Discard;
+		XMLParserOptions parserOptions;
+	};
+
+	struct FeedResult
+	{
+		size_t feedIndex = 0;
+		// without document if the feed failed
+		XMLWrapper document;
+		// empty if the feed was loaded
+		std::string error;
+	};
+
+	// parseThreads 0 means hardware concurrency, the documents are parsed through parserPool (optional)
+	explicit XMLFeedLoader(size_t maxConnections = 8, size_t parseThreads = 0, std::shared_ptr<XMLParserPool> parserPool = nullptr);
+
+	// return, once every feed is delivered, the number of feeds loaded. A failed feed is delivered too, with its error.
+	// The onLoaded calls are serialized, an exception thrown by onLoaded stops the loading and it is rethrown
+	size_t load(const std::vector<Feed> &feeds, const std::function<void(FeedResult &&result)> &onLoaded) const;
+
+  private:
+	size_t _maxConnections;
+	size_t _parseThreads;
+	std::shared_ptr<XMLParserPool> _parserPool;
 };
+
+template <typename T> bool XMLWrapper::assignValue(std::string_view text, T &value)
+{
+	if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, int64_t>)
+	{
+		int64_t parsed;
+		if (parseValue(text, parsed) != ValueError::None || !std::in_range<T>(parsed))
+			return false;
+		value = static_cast<T>(parsed);
+
+		return true;
+	}
+	else if constexpr (std::is_floating_point_v<T> && !std::is_same_v<T, double>)
+	{
+		double parsed;
+		if (parseValue(text, parsed) != ValueError::None)
+			return false;
+		value = static_cast<T>(parsed);
+
+		return true;
+	}
+	else
+		return parseValue(text, value) == ValueError::None;
+}
+
+template <typename Record, typename... Members>
+XMLBindingTarget XMLWrapper::bindingTarget(const XMLBinding<Record, Members...> &binding, std::vector<Record> &records)
+{
+	XMLBindingTarget target;
+	target.recordPath = binding.recordPath;
+	std::apply([&target](const auto &...fields) { (target.fieldPaths.push_back(fields.path), ...); }, binding.fields);
+	target.newRecord = [&records]() { records.emplace_back(); };
+	target.assign = [&binding, &records](const size_t fieldIndex, std::string_view value)
+	{
+		return std::apply(
+			[&](const auto &...fields)
+			{
+				size_t index = 0;
+				bool assigned = false;
+				((index++ == fieldIndex && (assigned = assignValue(value, records.back().*(fields.member)), true)) || ...);
+
+				return assigned;
+			},
+			binding.fields
+		);
+	};
+
+	return target;
+}
+
+template <typename Record, typename... Members>
+std::vector<Record> XMLWrapper::bindFile(const std::string &pathName, const XMLBinding<Record, Members...> &binding, const XMLParserOptions &parserOptions)
+{
+	std::vector<Record> records;
+	parseBindingFile(pathName, bindingTarget(binding, records), parserOptions);
+
+	return records;
+}
+
+template <typename Record, typename... Members>
+std::vector<Record> XMLWrapper::bindMemory(std::string_view xml, const XMLBinding<Record, Members...> &binding, const XMLParserOptions &parserOptions)
+{
+	std::vector<Record> records;
+	parseBindingMemory(xml, bindingTarget(binding, records), parserOptions);
+
+	return records;
+}